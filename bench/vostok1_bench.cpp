@@ -0,0 +1,184 @@
+// CPU side microbenchmarks of loading and of the per frame path. Run from the repository root, the
+// assets are loaded by relative path like in the application:
+//   ./vostok1_bench --benchmark_out=bench.json --benchmark_out_format=json
+// The GL benchmarks measure submission cost through an invisible window. Without a GPU a software
+// driver stands in (Mesa: LIBGL_ALWAYS_SOFTWARE=1); without any context they are skipped.
+
+#include <benchmark/benchmark.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLState.h>
+#include <rg/JobSystem.h>
+#include <rg/Orbits.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+GLFWwindow* benchWindow = nullptr;
+
+const char* const CUBEMAP_FACES[] = {"resources/textures/right.png", "resources/textures/left.png",
+                                     "resources/textures/top.png", "resources/textures/bot.png",
+                                     "resources/textures/front.png", "resources/textures/back.png"};
+
+bool requireContext(benchmark::State& state) {
+    if (benchWindow == nullptr)
+        state.SkipWithError("no GL context");
+    return benchWindow != nullptr;
+}
+
+// every iteration loads the whole asset, textures uploaded; the GL objects are not freed (Model does
+// not own them), which a handful of iterations can afford
+void BM_ModelLoad(benchmark::State& state, const char* path) {
+    if (!requireContext(state))
+        return;
+    for (auto _ : state) {
+        Model model(path);
+        benchmark::DoNotOptimize(model.meshes.data());
+    }
+}
+BENCHMARK_CAPTURE(BM_ModelLoad, earth, "resources/objects/earth/scene.gltf")->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_ModelLoad, clouds, "resources/objects/clouds/scene.gltf")->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_ModelLoad, vostok, "resources/objects/vostok/scene.gltf")->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_ModelLoad, moon, "resources/objects/moon/scene.gltf")->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_ModelLoad, sun, "resources/objects/sun/scene.gltf")->Unit(benchmark::kMillisecond)->Iterations(3);
+
+// decoding only, the upload is part of BM_ModelLoad
+void BM_CubemapFaceLoad(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const char* face : CUBEMAP_FACES) {
+            int width, height, channels;
+            unsigned char* data = stbi_load(face, &width, &height, &channels, 0);
+            benchmark::DoNotOptimize(data);
+            stbi_image_free(data);
+        }
+    }
+}
+BENCHMARK(BM_CubemapFaceLoad)->Unit(benchmark::kMillisecond);
+
+// the model matrices of one frame
+void BM_OrbitalMatrices(benchmark::State& state) {
+    float time = 0.0f;
+    for (auto _ : state) {
+        glm::mat4 earth = rg::earthModel(time);
+        glm::mat4 clouds = rg::cloudsModel(time, 3.0f);
+        glm::mat4 vostok = rg::vostokModel(time);
+        glm::mat4 moon = rg::moonModel(time);
+        glm::mat4 sun = rg::sunModel();
+        benchmark::DoNotOptimize(earth);
+        benchmark::DoNotOptimize(clouds);
+        benchmark::DoNotOptimize(vostok);
+        benchmark::DoNotOptimize(moon);
+        benchmark::DoNotOptimize(sun);
+        time += 1.0f / 60.0f;
+    }
+}
+BENCHMARK(BM_OrbitalMatrices);
+
+// scheduling cost of the job system: one job per index, next to no work in each
+void BM_JobSystemParallelFor(benchmark::State& state) {
+    size_t count = state.range(0);
+    std::vector<float> values(count);
+    for (auto _ : state) {
+        rg::jobs().parallelFor(0, count, 1, [&](size_t i) { values[i] = std::sqrt((float)i); });
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_JobSystemParallelFor)->Arg(64)->Arg(1024);
+
+// the uniforms main sets on the lit shader every frame
+void BM_ShaderSetUniforms(benchmark::State& state) {
+    if (!requireContext(state))
+        return;
+    Shader shader("resources/shaders/vertex_shader.vs", "resources/shaders/fragment_shader.fs");
+    shader.use();
+    glm::mat4 matrix(1.0f);
+    glm::vec3 vector(1.0f);
+    for (auto _ : state) {
+        shader.setVec3("pointLight.position", vector);
+        shader.setVec3("pointLight.ambient", vector);
+        shader.setVec3("pointLight.diffuse", vector);
+        shader.setVec3("pointLight.specular", vector);
+        shader.setFloat("pointLight.constant", 1.0f);
+        shader.setFloat("pointLight.linear", 1.0f);
+        shader.setFloat("pointLight.quadratic", 1.0f);
+        shader.setVec3("viewPosition", vector);
+        shader.setFloat("material.shininess", 8.0f);
+        shader.setMat4("projection", matrix);
+        shader.setMat4("view", matrix);
+        shader.setMat4("model", matrix);
+    }
+    state.SetItemsProcessed(state.iterations() * 12);
+}
+BENCHMARK(BM_ShaderSetUniforms);
+
+// Mesh::Draw of every mesh of the capsule, material binds included. Only the submission is timed; the
+// driver may still block once its command queue is full.
+void BM_MeshDraw(benchmark::State& state) {
+    if (!requireContext(state))
+        return;
+    static std::unique_ptr<Model> model;
+    if (!model)
+        model.reset(new Model("resources/objects/vostok/scene.gltf"));
+    Shader shader("resources/shaders/vertex_shader.vs", "resources/shaders/fragment_shader.fs");
+    rg::glState().invalidate();
+    shader.use();
+    for (auto _ : state) {
+        for (Mesh& mesh : model->meshes)
+            mesh.Draw(shader);
+    }
+    glFinish();
+    state.SetItemsProcessed(state.iterations() * model->meshes.size());
+}
+BENCHMARK(BM_MeshDraw);
+
+// one frame of mouse look and movement
+void BM_CameraUpdate(benchmark::State& state) {
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    for (auto _ : state) {
+        camera.ProcessMouseMovement(1.5f, -0.5f);
+        camera.ProcessKeyboard(FORWARD, 1.0f / 60.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+        benchmark::DoNotOptimize(view);
+    }
+}
+BENCHMARK(BM_CameraUpdate);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    if (glfwInit()) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        benchWindow = glfwCreateWindow(64, 64, "vostok1_bench", NULL, NULL);
+    }
+    if (benchWindow != nullptr) {
+        glfwMakeContextCurrent(benchWindow);
+        glfwSwapInterval(0);
+        if (gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            rg::loadGLExtensions((GLADloadproc) glfwGetProcAddress);
+        } else {
+            glfwDestroyWindow(benchWindow);
+            benchWindow = nullptr;
+        }
+    }
+    stbi_set_flip_vertically_on_load(true);
+
+    benchmark::RunSpecifiedBenchmarks();
+    glfwTerminate();
+    return 0;
+}
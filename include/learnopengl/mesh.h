@@ -7,7 +7,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+#include <rg/Material.h>
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 using namespace std;
@@ -33,90 +38,72 @@ struct Texture {
     string path;
 };
 
+// a mesh's vertex data where it was built (a model's scratch arena), read by the upload only
+struct MeshGeometry {
+    Vertex* vertices = nullptr;
+    unsigned int vertexCount = 0;
+    unsigned int* indices = nullptr;
+    unsigned int indexCount = 0;
+    // the positions again, tightly packed, for the depth stream
+    glm::vec3* positions = nullptr;
+};
+
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data; a CPU copy of what is on the GPU, empty unless it was asked to be kept (picking, culling
+    // against triangles); the buffers hold indexCount indices either way
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
-    vector<Texture>      textures;
+    unsigned int indexCount = 0;
+    // textures resolved to fixed units once at load, shared with every mesh that uses the same maps
+    std::shared_ptr<rg::Material> material;
 
     unsigned int VAO;
-    std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // positions only, tightly packed, for the depth pre-pass; shares the index buffer with VAO
+    unsigned int depthVAO;
+    // radius of the sphere around the model space origin that contains every vertex, used for depth sorting
+    float boundingRadius = 0.0f;
+    // constructor; keeps the vertex data, pass it with std::move to spare the copy
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, const vector<Texture>& textures)
+        : vertices(std::move(vertices)), indices(std::move(indices))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        vector<glm::vec3> positions;
+        positions.reserve(this->vertices.size());
+        for (const Vertex& vertex : this->vertices)
+            positions.push_back(vertex.Position);
+        MeshGeometry geometry;
+        geometry.vertices = this->vertices.data();
+        geometry.vertexCount = this->vertices.size();
+        geometry.indices = this->indices.data();
+        geometry.indexCount = this->indices.size();
+        geometry.positions = positions.data();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        uploadBuffers(geometry);
+        setupMesh(textures);
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // only uploads the buffers, which works on a context sharing objects with the one that draws;
+    // setupMesh() has to follow there. The geometry is copied to the CPU side only if kept.
+    Mesh(const MeshGeometry& geometry, bool keepGeometry)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-
-        for(unsigned int i = 0; i < textures.size(); i++)
+        uploadBuffers(geometry);
+        if (keepGeometry)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            vertices.assign(geometry.vertices, geometry.vertices + geometry.vertexCount);
+            indices.assign(geometry.indices, geometry.indices + geometry.indexCount);
         }
-
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // the vertex arrays, which are never shared between contexts, and the material
+    void setupMesh(const vector<Texture>& textures)
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        this->material = createMaterial(textures);
 
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
+        rg::GLState& state = rg::glState();
+        state.bindVertexArray(VAO = createVertexArray());
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
@@ -134,7 +121,84 @@ private:
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-        glBindVertexArray(0);
+        state.bindVertexArray(depthVAO = createVertexArray());
+        glBindBuffer(GL_ARRAY_BUFFER, depthVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        state.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // render the mesh; the shader's samplers have to be pointed at the material slots (rg::setMaterialSamplers)
+    void Draw(Shader &shader)
+    {
+        rg::GLState& state = rg::glState();
+        material->bind(state, shader);
+
+        // draw mesh; the state cache knows what is bound, so there is nothing to reset afterwards
+        state.bindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        rg::glCalls().countDraw(indexCount / 3);
+    }
+
+private:
+    // render data
+    unsigned int VBO, EBO, depthVBO;
+
+    // only the first map of every kind is used, the shaders only know texture_*1
+    static std::shared_ptr<rg::Material> createMaterial(const vector<Texture>& textures)
+    {
+        unsigned int slots[rg::TEXTURE_SLOT_COUNT] = {0};
+        for (const Texture& texture : textures) {
+            rg::TextureSlot slot = rg::textureSlotFromType(texture.type);
+            if (slot != rg::TEXTURE_SLOT_COUNT && slots[slot] == 0)
+                slots[slot] = texture.id;
+        }
+        // a sampler without its own map used to read unit 0, keep that for specular
+        if (slots[rg::TEXTURE_SLOT_SPECULAR] == 0)
+            slots[rg::TEXTURE_SLOT_SPECULAR] = slots[rg::TEXTURE_SLOT_DIFFUSE];
+        return rg::materialCache().get(slots);
+    }
+
+    static unsigned int createVertexArray()
+    {
+        unsigned int vertexArray;
+        glGenVertexArrays(1, &vertexArray);
+        return vertexArray;
+    }
+
+    // initializes all the buffer objects. They go through GL_COPY_WRITE_BUFFER, which needs no vertex array
+    // bound (the element array binding is vertex array state) and disturbs no binding used for drawing.
+    void uploadBuffers(const MeshGeometry& geometry)
+    {
+        indexCount = geometry.indexCount;
+        for (unsigned int i = 0; i < geometry.vertexCount; i++)
+            boundingRadius = std::max(boundingRadius, glm::length(geometry.positions[i]));
+
+        // create buffers
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenBuffers(1, &depthVBO);
+
+        // load data into vertex buffers
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        // A great thing about structs is that their memory layout is sequential for all its items.
+        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+        // again translates to 3/2 floats which translates to a byte array.
+        glBufferData(GL_COPY_WRITE_BUFFER, geometry.vertexCount * sizeof(Vertex), geometry.vertices, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, geometry.indexCount * sizeof(unsigned int), geometry.indices, GL_STATIC_DRAW);
+
+        // position-only stream: a depth pass fetches 12 bytes per vertex instead of the whole Vertex
+        glBindBuffer(GL_COPY_WRITE_BUFFER, depthVBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, geometry.vertexCount * sizeof(glm::vec3), geometry.positions, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        rg::gpuMemory().bufferBytes += geometry.vertexCount * (sizeof(Vertex) + sizeof(glm::vec3))
+                                       + geometry.indexCount * sizeof(unsigned int);
     }
 };
 #endif
\ No newline at end of file
@@ -12,15 +12,34 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/GpuMemory.h>
+#include <rg/JobSystem.h>
+#include <rg/ScratchArena.h>
+#include <rg/StagingBuffer.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <vector>
 using namespace std;
 
+// a texture file decoded on the CPU, waiting for UploadTexture
+struct DecodedTexture {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char* data = nullptr;
+};
+
+// safe on any thread: stb_image keeps no state for a successful load (only the failure reason is shared)
+DecodedTexture DecodeTexture(const char *path, const string &directory);
+
+// on a thread with a context, through staging if given; frees the decoded data
+unsigned int UploadTexture(DecodedTexture &texture, const char *path, rg::StagingBuffer *staging = nullptr);
+
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
 
@@ -33,28 +52,25 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // keeps the meshes' vertices and indices on the CPU after the upload, for features that read them; set
+    // before load(). Otherwise only the GPU has them.
+    bool keepGeometry = false;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
     {
-        loadModel(path);
+        load(path);
+        upload();
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // an empty model to load() on another thread and upload() later
+    Model() : gammaCorrection(false)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
-        }
-    }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // the CPU part of loading: reads the file, builds the vertex data and decodes the textures, spread over
+    // the job system. Needs no context, so several models can load at once.
+    void load(string const &path)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -69,34 +85,171 @@ private:
         directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<aiMesh*> sceneMeshes;
+        processNode(scene->mRootNode, scene, sceneMeshes);
+        // the texture lookups share one list, so they run first; every mesh and texture is independent after
+        size_t firstMesh = pendingMeshes.size();
+        size_t firstTexture = pendingTextures.size();
+        pendingMeshes.resize(firstMesh + sceneMeshes.size());
+        for (size_t i = 0; i < sceneMeshes.size(); i++)
+            pendingMeshes[firstMesh + i].textures = loadMaterialTextures(scene->mMaterials[sceneMeshes[i]->mMaterialIndex]);
+        allocateGeometry(sceneMeshes, firstMesh);
+        size_t newTextures = pendingTextures.size() - firstTexture;
+        rg::jobs().parallelFor(0, sceneMeshes.size() + newTextures, 1, [&](size_t i) {
+            if (i < sceneMeshes.size()) {
+                processMesh(sceneMeshes[i], pendingMeshes[firstMesh + i]);
+            } else {
+                PendingTexture &texture = pendingTextures[firstTexture + i - sceneMeshes.size()];
+                texture.image = DecodeTexture(texture.path.c_str(), directory);
+            }
+        });
+    }
+
+    // creates the textures and buffers of what load() read, on the thread with the context
+    void upload()
+    {
+        uploadData(nullptr);
+        finishUpload();
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // the part of upload() that also works on a context sharing objects with the drawing one (the upload
+    // service's): textures, through staging if given, and buffers
+    void uploadData(rg::StagingBuffer *staging)
+    {
+        uploadedTextures.reserve(uploadedTextures.size() + pendingTextures.size());
+        for (PendingTexture &pending : pendingTextures)
+        {
+            Texture texture;
+            texture.id = UploadTexture(pending.image, pending.path.c_str(), staging);
+            texture.type = pending.type;
+            texture.path = std::move(pending.path);
+            uploadedTextures.push_back(std::move(texture));
+        }
+        uploadedMeshes.reserve(uploadedMeshes.size() + pendingMeshes.size());
+        uploadedMeshTextures.reserve(uploadedMeshTextures.size() + pendingMeshes.size());
+        for (PendingMesh &pending : pendingMeshes)
+        {
+            uploadedMeshes.emplace_back(pending.geometry, keepGeometry);
+            uploadedMeshTextures.push_back(std::move(pending.textures));
+        }
+        // vector::clear() keeps the capacity
+        vector<PendingTexture>().swap(pendingTextures);
+        vector<PendingMesh>().swap(pendingMeshes);
+        scratch.clear();
+    }
+
+    // the rest, on the drawing context once the uploads are complete; the meshes are drawn from then on
+    void finishUpload()
+    {
+        size_t firstTexture = textures_loaded.size();
+        // store them as textures loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        textures_loaded.insert(textures_loaded.end(), std::make_move_iterator(uploadedTextures.begin()),
+                               std::make_move_iterator(uploadedTextures.end()));
+        meshes.reserve(meshes.size() + uploadedMeshes.size());
+        vector<Texture> textures;
+        for (size_t i = 0; i < uploadedMeshes.size(); i++)
+        {
+            textures.clear();
+            for (unsigned int index : uploadedMeshTextures[i])
+                textures.push_back(textures_loaded[firstTexture + index]);
+            uploadedMeshes[i].setupMesh(textures);
+            meshes.push_back(std::move(uploadedMeshes[i]));
+        }
+        vector<Texture>().swap(uploadedTextures);
+        vector<Mesh>().swap(uploadedMeshes);
+        vector<vector<unsigned int>>().swap(uploadedMeshTextures);
+    }
+
+    // draws the model, and thus all its meshes
+    void Draw(Shader &shader)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader);
+    }
+
+    // biases the mip level every texture of the model is sampled at, positive values pick smaller mips
+    void setLodBias(float bias)
+    {
+        for (const Texture& texture : textures_loaded)
+        {
+            rg::glState().bindTexture(0, GL_TEXTURE_2D, texture.id);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, bias);
+        }
+    }
+
+private:
+    // what load() read for a mesh, turned into a Mesh by upload()
+    struct PendingMesh {
+        MeshGeometry geometry; // in scratch
+        vector<unsigned int> textures; // into pendingTextures
+    };
+    struct PendingTexture {
+        string type;
+        string path;
+        DecodedTexture image;
+    };
+    vector<PendingMesh> pendingMeshes;
+    vector<PendingTexture> pendingTextures;
+    // the vertex data of the pending meshes, an arena per load() that goes with the upload
+    vector<rg::ScratchArena> scratch;
+    // uploaded by uploadData(), not drawn before finishUpload()
+    vector<Texture> uploadedTextures;
+    vector<Mesh> uploadedMeshes;
+    vector<vector<unsigned int>> uploadedMeshTextures; // into uploadedTextures
+
+    // collects the meshes of a node in a recursive fashion, in the order they are drawn.
+    void processNode(aiNode *node, const aiScene *scene, vector<aiMesh*> &sceneMeshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, sceneMeshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // carves the vertex data of the meshes out of one arena, sized from the scene so that nothing grows
+    // while the meshes are filled in parallel
+    void allocateGeometry(const vector<aiMesh*> &sceneMeshes, size_t firstMesh)
+    {
+        vector<unsigned int> indexCounts(sceneMeshes.size(), 0);
+        size_t bytes = 0;
+        for (size_t i = 0; i < sceneMeshes.size(); i++)
+        {
+            const aiMesh *mesh = sceneMeshes[i];
+            for (unsigned int j = 0; j < mesh->mNumFaces; j++)
+                indexCounts[i] += mesh->mFaces[j].mNumIndices;
+            bytes = rg::ScratchArena::bytesFor<Vertex>(bytes, mesh->mNumVertices);
+            bytes = rg::ScratchArena::bytesFor<glm::vec3>(bytes, mesh->mNumVertices);
+            bytes = rg::ScratchArena::bytesFor<unsigned int>(bytes, indexCounts[i]);
+        }
+        scratch.emplace_back(bytes);
+        rg::ScratchArena &arena = scratch.back();
+        for (size_t i = 0; i < sceneMeshes.size(); i++)
+        {
+            MeshGeometry &geometry = pendingMeshes[firstMesh + i].geometry;
+            geometry.vertexCount = sceneMeshes[i]->mNumVertices;
+            geometry.vertices = arena.allocate<Vertex>(geometry.vertexCount);
+            geometry.positions = arena.allocate<glm::vec3>(geometry.vertexCount);
+            geometry.indexCount = indexCounts[i];
+            geometry.indices = arena.allocate<unsigned int>(geometry.indexCount);
+        }
+    }
+
+    // the vertex data of a mesh, into what allocateGeometry() set aside; runs on the job system, one mesh per job
+    void processMesh(aiMesh *mesh, PendingMesh &pending)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        Vertex *vertices = pending.geometry.vertices;
+        glm::vec3 *positions = pending.geometry.positions;
+        unsigned int *indices = pending.geometry.indices;
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -139,77 +292,62 @@ private:
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
-            vertices.push_back(vertex);
-
-
+            vertices[i] = vertex;
+            positions[i] = vertex.Position;
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        unsigned int index = 0;
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
+            const aiFace &face = mesh->mFaces[i];
+            // retrieve all indices of the face and store them in the indices array
             for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+                indices[index++] = face.mIndices[j];
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    }
+
+    // checks all material textures of a material and queues the textures not loaded yet for decoding; returns
+    // the mesh's textures as indices into pendingTextures
+    vector<unsigned int> loadMaterialTextures(aiMaterial *material)
+    {
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
         // Same applies to other texture as the following list summarizes:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
-    }
-
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
-    {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        const pair<aiTextureType, const char*> types[] = {
+                {aiTextureType_DIFFUSE, "texture_diffuse"},     // 1. diffuse maps
+                {aiTextureType_SPECULAR, "texture_specular"},   // 2. specular maps
+                {aiTextureType_NORMALS, "texture_normal"},      // 3. normal maps
+                {aiTextureType_HEIGHT, "texture_height"}        // 4. height maps
+        };
+        vector<unsigned int> textures;
+        for (const pair<aiTextureType, const char*> &type : types)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            for(unsigned int i = 0; i < material->GetTextureCount(type.first); i++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                aiString str;
+                material->GetTexture(type.first, i, &str);
+                // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
+                bool skip = false;
+                for(unsigned int j = 0; j < pendingTextures.size(); j++)
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
+                    if(std::strcmp(pendingTextures[j].path.data(), str.C_Str()) == 0)
+                    {
+                        textures.push_back(j);
+                        skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
+                        break;
+                    }
+                }
+                if(!skip)
+                {   // if texture hasn't been loaded already, decode it with the meshes
+                    PendingTexture texture;
+                    texture.type = type.second;
+                    texture.path = str.C_Str();
+                    textures.push_back(pendingTextures.size());
+                    pendingTextures.push_back(texture);
                 }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
             }
         }
         return textures;
@@ -217,16 +355,23 @@ private:
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+DecodedTexture DecodeTexture(const char *path, const string &directory)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    DecodedTexture texture;
+    texture.data = stbi_load(filename.c_str(), &texture.width, &texture.height, &texture.components, 0);
+    return texture;
+}
+
+unsigned int UploadTexture(DecodedTexture &texture, const char *path, rg::StagingBuffer *staging)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    int width = texture.width, height = texture.height, nrComponents = texture.components;
+    unsigned char *data = texture.data;
     if (data) {
         GLenum internalFormat;
         GLenum dataFormat;
@@ -245,8 +390,14 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
             //internalFormat = GL_RGBA;//no gamma correction
         }
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+        // from the staging buffer the pixels are read at offset 0 of it
+        bool staged = staging && staging->stage(data, (size_t)width * height * nrComponents);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, staged ? nullptr : data);
+        if (staged)
+            staging->unbind();
         glGenerateMipmap(GL_TEXTURE_2D);
+        //drivers store 3 channels as 4
+        rg::gpuMemory().textureBytes += rg::mipmappedTextureBytes(width, height, nrComponents == 3 ? 4 : nrComponents);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -260,7 +411,14 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         std::cout << "Texture failed to load at path: " << path << std::endl;
         stbi_image_free(data);
     }
+    texture.data = nullptr;
 
     return textureID;
 }
+
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    DecodedTexture texture = DecodeTexture(path, directory);
+    return UploadTexture(texture, path);
+}
 #endif
@@ -4,174 +4,420 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <rg/GLDebug.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLState.h>
+#include <rg/ProgramBinaryCache.h>
 class Shader
 {
 public:
-    unsigned int ID;
+    unsigned int ID = 0;
+    // called after every successful link (first build and reloads), the place for uniforms that are set
+    // once per program like sampler units
+    std::function<void(Shader&)> onLinked;
+    // of the material's emissive uniform, looked up after every link by rg::setMaterialSamplers so that
+    // binding a material needs no lookup; -1 (uploads are ignored) in programs without one
+    int materialEmissiveLocation = -1;
+    // every file the program was built from, includes too
+    std::vector<std::string> files;
+
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : Shader(vertexPath, fragmentPath, std::vector<std::string>(), geometryPath)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
+    }
+    // every entry of defines ("NAME" or "NAME VALUE") is injected as a #define right after the #version
+    // line of each stage, so one source file can be compiled into several program variants
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines, const char* geometryPath = nullptr)
+        : m_VertexPath(vertexPath)
+        , m_FragmentPath(fragmentPath)
+        , m_GeometryPath(geometryPath != nullptr ? geometryPath : "")
+        , m_Defines(defines)
+    {
+        reload();
+        wait();
+    }
+    // like the constructor, but only hands the work to the driver; ID stays 0 until wait() or poll()
+    // finishes it. Creating all programs like this before waiting on any lets a driver with
+    // KHR_parallel_shader_compile build them concurrently.
+    // ------------------------------------------------------------------------
+    static Shader deferred(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>())
+    {
+        Shader shader(vertexPath, fragmentPath, defines, DeferredTag());
+        shader.reload();
+        return shader;
+    }
+    // a compute program from a single file; deferred like deferred(), so wait() or poll() before use
+    // ------------------------------------------------------------------------
+    static Shader compute(const char* computePath, const std::vector<std::string>& defines = std::vector<std::string>())
+    {
+        Shader shader("", "", defines, DeferredTag());
+        shader.m_ComputePath = computePath;
+        shader.reload();
+        return shader;
+    }
+    // starts building a new program from the files; ID keeps the old program until the new one links
+    // ------------------------------------------------------------------------
+    void reload()
+    {
+        if (m_Pending.program != 0)
+            discard(m_Pending);
+        files.clear();
+        std::vector<StageSource> sources;
+        if (!m_ComputePath.empty())
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            sources.push_back({GL_COMPUTE_SHADER, m_ComputePath});
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        else
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            sources.push_back({GL_VERTEX_SHADER, m_VertexPath});
+            sources.push_back({GL_FRAGMENT_SHADER, m_FragmentPath});
+            if (!m_GeometryPath.empty())
+                sources.push_back({GL_GEOMETRY_SHADER, m_GeometryPath});
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        m_Pending = start(sources, m_Defines, files);
+    }
+    bool pending() const
+    {
+        return m_Pending.program != 0;
+    }
+    // finishes a pending build if the driver is done with it, without waiting when the driver supports
+    // KHR_parallel_shader_compile (otherwise the status query itself waits). Returns true if ID changed.
+    // ------------------------------------------------------------------------
+    bool poll()
+    {
+        if (!pending() || !complete(m_Pending))
+            return false;
+        return finish();
+    }
+    // finishes a pending build, waiting for the driver if needed. Returns true if ID changed.
+    bool wait()
+    {
+        return pending() && finish();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        rg::glState().useProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(location(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(location(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    struct DeferredTag {};
+
+    int location(const std::string &name) const
+    {
+        rg::glCalls().count(rg::GL_CALL_UNIFORM, 2);//the lookup and the upload that follows
+        return glGetUniformLocation(ID, name.c_str());
+    }
+    struct StageSource {
+        GLenum type;
+        std::string path;
+    };
+    // a program the driver may still be compiling and linking
+    struct PendingBuild {
+        unsigned int program = 0;
+        unsigned int stages[3] = {0, 0, 0};
+        GLenum stageTypes[3] = {0, 0, 0};
+        uint64_t binaryKey = 0;
+        bool fromBinary = false;
+    };
+
+    std::string m_VertexPath;
+    std::string m_FragmentPath;
+    std::string m_GeometryPath;
+    std::string m_ComputePath;
+    std::vector<std::string> m_Defines;
+    PendingBuild m_Pending;
+
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines, DeferredTag)
+        : m_VertexPath(vertexPath)
+        , m_FragmentPath(fragmentPath)
+        , m_Defines(defines)
+    {
+    }
+
+    bool finish()
+    {
+        PendingBuild build = m_Pending;
+        m_Pending = PendingBuild();
+
+        bool success = build.fromBinary;
+        if (!build.fromBinary)
+        {
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                if (build.stages[i] != 0)
+                    checkCompileErrors(build.stages[i], stageName(build.stageTypes[i]));
+            }
+            success = checkCompileErrors(build.program, "PROGRAM");
+            if (success && rg::programBinaryCache().enabled())
+                rg::programBinaryCache().store(build.binaryKey, build.program);
+            // delete the shaders as they're linked into our program now and no longer necessery
+            for (unsigned int stage : build.stages)
+            {
+                if (stage != 0)
+                    glDeleteShader(stage);
+            }
+        }
+        // a broken first build is kept so that the errors show up like before, a broken reload is dropped
+        if (!success && ID != 0)
+        {
+            glDeleteProgram(build.program);
+            return false;
+        }
+        if (ID != 0)
+        {
+            glDeleteProgram(ID);
+            rg::glState().forgetProgram(ID);
+        }
+        ID = build.program;
+        if (rg::glDebugOutputEnabled())
+            rg::labelGLObject(GL_PROGRAM, ID, label().c_str());
+        if (success && onLinked)
+            onLinked(*this);
+        return true;
+    }
+
+    // main source file and defines, e.g. "fragment_shader.fs ENABLE_FONG HEATMAP"
+    std::string label() const
+    {
+        std::string path = m_ComputePath.empty() ? m_FragmentPath : m_ComputePath;
+        std::string result = path.substr(path.find_last_of('/') + 1);
+        for (const std::string& define : m_Defines)
+            result += " " + define;
+        return result;
+    }
+
+    static void discard(PendingBuild& build)
+    {
+        for (unsigned int stage : build.stages)
+        {
+            if (stage != 0)
+                glDeleteShader(stage);
+        }
+        glDeleteProgram(build.program);
+        build = PendingBuild();
+    }
+
+    static bool complete(const PendingBuild& build)
+    {
+        if (build.fromBinary || !rg::glExtensions().parallelShaderCompile)
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // reads and preprocesses the sources and issues compile and link without asking for any status,
+    // every query would make the driver finish the work right away
+    // ------------------------------------------------------------------------
+    static PendingBuild start(const std::vector<StageSource>& sources, const std::vector<std::string>& defines,
+                              std::vector<std::string>& files)
+    {
+        // 1. retrieve the source code of every stage from its file
+        std::vector<std::string> codes;
+        for (const StageSource& source : sources)
+            codes.push_back(preprocess(readSource(source.path), source.path, defines, files));
+
+        PendingBuild build;
+        build.program = glCreateProgram();
+        // a binary from an earlier run saves compiling and linking altogether
+        rg::ProgramBinaryCache& binaryCache = rg::programBinaryCache();
+        if (binaryCache.enabled())
+        {
+            build.binaryKey = binaryCache.key(codes, defines);
+            if (binaryCache.load(build.binaryKey, build.program))
+            {
+                build.fromBinary = true;
+                return build;
+            }
+        }
+
+        // 2. compile shaders
+        for (unsigned int i = 0; i < sources.size() && i < 3; i++)
+        {
+            const char* code = codes[i].c_str();
+            build.stageTypes[i] = sources[i].type;
+            build.stages[i] = glCreateShader(sources[i].type);
+            glShaderSource(build.stages[i], 1, &code, NULL);
+            glCompileShader(build.stages[i]);
+            glAttachShader(build.program, build.stages[i]);
+        }
+        // shader Program
+        if (binaryCache.enabled())
+            binaryCache.prepare(build.program);
+        glLinkProgram(build.program);
+        return build;
+    }
+
+    static std::string readSource(const std::string& path)
+    {
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        }
+        return "";
+    }
+
+    // resolves #include "file" (relative to the including file) and adds the defines after #version. Line
+    // numbers in compiler messages are those of the file the line is in, #line directives reset them around
+    // the defines and every included body.
+    // ------------------------------------------------------------------------
+    static std::string preprocess(const std::string& source, const std::string& path, const std::vector<std::string>& defines,
+                                  std::vector<std::string>& files)
+    {
+        files.push_back(path);
+        std::string code = resolveIncludes(source, path, 0, files);
+        size_t versionLine = code.find("#version");
+        if (versionLine == std::string::npos)
+            return code;
+        size_t insertAt = code.find('\n', versionLine);
+        if (insertAt == std::string::npos)
+            return code;
+        insertAt++;
+
+        std::string block;
+        for (const std::string& define : defines)
+            block += "#define " + define + "\n";
+        // #version comes before any include, so the lines up to it are the file's own
+        unsigned int nextLine = 1 + std::count(code.begin(), code.begin() + insertAt, '\n');
+        block += "#line " + std::to_string(nextLine) + "\n";
+        return code.insert(insertAt, block);
+    }
+    static std::string resolveIncludes(const std::string& source, const std::string& path, unsigned int depth,
+                                       std::vector<std::string>& files)
+    {
+        const unsigned int MAX_INCLUDE_DEPTH = 16;
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::istringstream lines(source);
+        std::string result;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(lines, line))
+        {
+            lineNumber++;
+            size_t directive = line.find_first_not_of(" \t");
+            if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', directive);
+                size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos || depth >= MAX_INCLUDE_DEPTH)
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_FAILED " << path << ": " << line << std::endl;
+                    result += '\n';// keeps the following lines where they are
+                    continue;
+                }
+                std::string includePath = directory + line.substr(open + 1, close - open - 1);
+                std::string included = readFileContents(includePath);
+                if (included.empty())
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << includePath << std::endl;
+                files.push_back(includePath);
+                // the included lines count from 1, the ones after it go on where the #include was
+                result += "#line 1\n";
+                result += resolveIncludes(included, includePath, depth + 1, files);
+                result += "#line " + std::to_string(lineNumber + 1) + "\n";
+                continue;
+            }
+            result += line;
+            result += '\n';
+        }
+        return result;
+    }
+    static const char* stageName(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_VERTEX_SHADER: return "VERTEX";
+            case GL_FRAGMENT_SHADER: return "FRAGMENT";
+            case GL_GEOMETRY_SHADER: return "GEOMETRY";
+            case GL_COMPUTE_SHADER: return "COMPUTE";
+            default: return "UNKNOWN";
+        }
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    // returns true when there was no error
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +439,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
@@ -0,0 +1,126 @@
+#ifndef PROJECT_BASE_AUTOEXPOSURE_H
+#define PROJECT_BASE_AUTOEXPOSURE_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader.h>
+#include <rg/GLDebug.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLState.h>
+
+#include <cmath>
+
+namespace rg {
+
+struct AutoExposureSettings {
+    // log2 luminance range the histogram covers, darker samples (the black of space) are left out
+    float minLogLuminance = -10.0f;
+    float maxLogLuminance = 6.0f;
+    // average luminance that ends up at exposure 1, relative to the tone mapper's input
+    float key = 0.5f;
+    float minExposure = 0.1f;
+    float maxExposure = 10.0f;
+    // 1/s, how quickly the eye follows a change in brightness
+    float adaptationSpeed = 1.5f;
+};
+
+// Eye adaptation on the GPU. A compute pass builds a histogram of log luminance over every
+// SAMPLE_STRIDE-th pixel of the HDR target, a second one averages it, eases the adapted luminance
+// towards the average and writes the resulting exposure into a 1x1 R32F texture that the tone mapper
+// samples. Nothing is read back, so the CPU never waits for the GPU. Needs GL 4.3
+// (glExtensions().computeShader).
+class AutoExposure {
+public:
+    static const unsigned int BIN_COUNT = 256; // also the work group size of both shaders
+    static const unsigned int SAMPLE_STRIDE = 4;
+
+    Shader histogramShader;
+    Shader averageShader;
+    AutoExposureSettings settings;
+
+    AutoExposure()
+        : histogramShader(Shader::compute("resources/shaders/luminance_histogram.comp"))
+        , averageShader(Shader::compute("resources/shaders/luminance_average.comp")) {
+        histogramShader.onLinked = [](Shader& shader) {
+            shader.use();
+            shader.setInt("scene", 0);
+        };
+
+        glGenBuffers(1, &m_Histogram);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Histogram);
+        unsigned int zeros[BIN_COUNT] = {0};
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_COPY);
+        labelGLObject(GL_BUFFER, m_Histogram, "luminance histogram");
+
+        // the adapted luminance carries over from frame to frame; starts at the key, i.e. exposure 1
+        glGenBuffers(1, &m_Adaptation);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Adaptation);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float), &settings.key, GL_DYNAMIC_COPY);
+        labelGLObject(GL_BUFFER, m_Adaptation, "adapted luminance");
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glGenTextures(1, &m_Exposure);
+        glState().bindTexture(GL_TEXTURE_2D, m_Exposure);
+        float exposure = 1.0f;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 1, 1, 0, GL_RED, GL_FLOAT, &exposure);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        labelGLObject(GL_TEXTURE, m_Exposure, "exposure");
+    }
+
+    ~AutoExposure() {
+        glDeleteBuffers(1, &m_Histogram);
+        glDeleteBuffers(1, &m_Adaptation);
+        glState().forgetTexture(m_Exposure);
+        glDeleteTextures(1, &m_Exposure);
+    }
+
+    AutoExposure(const AutoExposure&) = delete;
+    AutoExposure& operator=(const AutoExposure&) = delete;
+
+    // 1x1 GL_R32F, the exposure for the current frame once update() ran
+    unsigned int exposureTexture() const {
+        return m_Exposure;
+    }
+
+    // call after the scene pass, before the tone mapper samples exposureTexture()
+    void update(unsigned int hdrTexture, unsigned int width, unsigned int height, float deltaTime) {
+        const GLExtensions& ext = glExtensions();
+        GLState& state = glState();
+        unsigned int samplesX = (width + SAMPLE_STRIDE - 1) / SAMPLE_STRIDE;
+        unsigned int samplesY = (height + SAMPLE_STRIDE - 1) / SAMPLE_STRIDE;
+        float logRange = settings.maxLogLuminance - settings.minLogLuminance;
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Histogram);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_Adaptation);
+
+        histogramShader.use();
+        histogramShader.setFloat("minLogLuminance", settings.minLogLuminance);
+        histogramShader.setFloat("inverseLogLuminanceRange", 1.0f / logRange);
+        glUniform2i(glGetUniformLocation(histogramShader.ID, "sampleCount"), samplesX, samplesY);
+        state.bindTexture(0, GL_TEXTURE_2D, hdrTexture);
+        ext.DispatchCompute((samplesX + 15) / 16, (samplesY + 15) / 16, 1);
+        glCalls().count(GL_CALL_DRAW);
+        ext.MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        averageShader.use();
+        averageShader.setFloat("minLogLuminance", settings.minLogLuminance);
+        averageShader.setFloat("logLuminanceRange", logRange);
+        averageShader.setFloat("adaptation", 1.0f - std::exp(-deltaTime * settings.adaptationSpeed));
+        averageShader.setFloat("key", settings.key);
+        averageShader.setFloat("minExposure", settings.minExposure);
+        averageShader.setFloat("maxExposure", settings.maxExposure);
+        ext.BindImageTexture(0, m_Exposure, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        ext.DispatchCompute(1, 1, 1);
+        glCalls().count(GL_CALL_DRAW);
+        ext.MemoryBarrierGL(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+private:
+    unsigned int m_Histogram = 0;
+    unsigned int m_Adaptation = 0;
+    unsigned int m_Exposure = 0;
+};
+
+}
+
+#endif //PROJECT_BASE_AUTOEXPOSURE_H
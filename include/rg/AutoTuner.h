@@ -0,0 +1,93 @@
+#ifndef PROJECT_BASE_AUTOTUNER_H
+#define PROJECT_BASE_AUTOTUNER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+
+namespace rg {
+
+// identifies the GPU and driver the settings were tuned on
+std::string deviceFingerprint() {
+    std::string fingerprint;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* value = (const char*)glGetString(name);
+        if (!fingerprint.empty())
+            fingerprint += " | ";
+        fingerprint += value != nullptr ? value : "";
+    }
+    return fingerprint;
+}
+
+// Picks the highest quality preset that holds a target frame time. The presets are measured from the
+// highest quality down, each over a fixed number of frames the caller renders with preset(); the first
+// one whose average frame cost stays within the target wins, the last one if none does. The cost of a
+// frame is the larger of its CPU and GPU time, so vsync does not hide anything.
+class AutoTuner {
+public:
+    // frames after a switch that are not measured: the targets get reallocated and the GPU timers still
+    // report frames of the previous preset
+    static const unsigned int WARMUP_FRAMES = 10;
+    static const unsigned int MEASURED_FRAMES = 40;
+    static const unsigned int FRAMES_PER_PRESET = WARMUP_FRAMES + MEASURED_FRAMES;
+
+    void start(unsigned int presetCount, float targetMs) {
+        m_PresetCount = presetCount;
+        m_TargetMs = targetMs;
+        m_Preset = 0;
+        m_Frame = 0;
+        m_SumMs = 0.0f;
+        m_Running = presetCount > 0;
+    }
+
+    bool running() const {
+        return m_Running;
+    }
+
+    // the preset to render with, the chosen one once done
+    unsigned int preset() const {
+        return m_Preset;
+    }
+
+    // position in the current preset's run, for the caller's fixed sequence
+    unsigned int frame() const {
+        return m_Frame;
+    }
+
+    // average frame cost of the last measured preset
+    float measuredMs() const {
+        return m_MeasuredMs;
+    }
+
+    // after every frame rendered with preset(); true when the preset changed or the tuning finished
+    bool record(float cpuMs, float gpuMs) {
+        if (!m_Running)
+            return false;
+        if (m_Frame++ >= WARMUP_FRAMES)
+            m_SumMs += std::max(cpuMs, gpuMs);
+        if (m_Frame < FRAMES_PER_PRESET)
+            return false;
+        m_MeasuredMs = m_SumMs / MEASURED_FRAMES;
+        m_Frame = 0;
+        m_SumMs = 0.0f;
+        if (m_MeasuredMs <= m_TargetMs || m_Preset + 1 == m_PresetCount)
+            m_Running = false;
+        else
+            m_Preset++;
+        return true;
+    }
+
+private:
+    unsigned int m_PresetCount = 0;
+    float m_TargetMs = 0.0f;
+    unsigned int m_Preset = 0;
+    unsigned int m_Frame = 0;
+    float m_SumMs = 0.0f;
+    float m_MeasuredMs = 0.0f;
+    bool m_Running = false;
+};
+
+}
+
+#endif //PROJECT_BASE_AUTOTUNER_H
@@ -0,0 +1,65 @@
+#ifndef PROJECT_BASE_BANDWIDTH_H
+#define PROJECT_BASE_BANDWIDTH_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+struct HdrFormat {
+    const char* name;
+    GLenum internalFormat;
+    GLenum format;
+    unsigned int bytesPerPixel;
+};
+
+// Formats the HDR scene and bloom targets can use. Nothing downstream reads the alpha channel, so the
+// packed float format loses nothing but precision the tone mapper does not show.
+const HdrFormat HDR_FORMATS[] = {
+        {"R11F_G11F_B10F (4 B/px)", GL_R11F_G11F_B10F, GL_RGB, 4},
+        {"RGBA16F (8 B/px)", GL_RGBA16F, GL_RGBA, 8}
+};
+const int HDR_FORMAT_COUNT = sizeof(HDR_FORMATS) / sizeof(HDR_FORMATS[0]);
+
+struct PassTraffic {
+    const char* pass;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+};
+
+// Render target traffic of one frame, estimated from target sizes and formats: every pixel of a
+// fullscreen pass is written once and each input texel is read once (the texture cache absorbs the
+// neighbouring taps of a filter). Overdraw and blending reads in the scene pass are not included,
+// so the numbers are a lower bound that is good for comparing formats and settings.
+class BandwidthEstimate {
+public:
+    std::vector<PassTraffic> passes;
+
+    void clear() {
+        passes.clear();
+    }
+
+    void add(const char* pass, uint64_t bytesRead, uint64_t bytesWritten) {
+        passes.push_back({pass, bytesRead, bytesWritten});
+    }
+
+    uint64_t totalRead() const {
+        uint64_t total = 0;
+        for (const PassTraffic& traffic : passes)
+            total += traffic.bytesRead;
+        return total;
+    }
+
+    uint64_t totalWritten() const {
+        uint64_t total = 0;
+        for (const PassTraffic& traffic : passes)
+            total += traffic.bytesWritten;
+        return total;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_BANDWIDTH_H
@@ -7,12 +7,20 @@
 
 #include <iostream>
 #include <glad/glad.h>
+#include <rg/GLDebug.h>
 
 #define LOG(stream) stream << "[" << __FILE__ << ", " << __func__ << ", " << __LINE__ << "] "
 #define BREAK_IF_FALSE(x) if (!(x)) __builtin_trap()
 #define ASSERT(x, msg) do { if (!(x)) { std::cerr << msg << '\n'; BREAK_IF_FALSE(false); } } while(0)
+// With KHR_debug the driver reports errors through rg::glDebugCallback, without the two glGetError round
+// trips per call; polling is only the fallback. Release builds (RG_GL_DEBUG 0) check nothing.
+#if RG_GL_DEBUG
 #define GLCALL(x) \
-do{ rg::clearAllOpenGlErrors(); x; BREAK_IF_FALSE(rg::wasPreviousOpenGLCallSuccessful(__FILE__, __LINE__, #x)); } while (0)
+do{ if (rg::glDebugOutputEnabled()) { x; break; } \
+    rg::clearAllOpenGlErrors(); x; BREAK_IF_FALSE(rg::wasPreviousOpenGLCallSuccessful(__FILE__, __LINE__, #x)); } while (0)
+#else
+#define GLCALL(x) do{ x; } while (0)
+#endif
 
 namespace rg {
 
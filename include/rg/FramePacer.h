@@ -0,0 +1,144 @@
+#ifndef PROJECT_BASE_FRAMEPACER_H
+#define PROJECT_BASE_FRAMEPACER_H
+
+#include <glad/glad.h>
+#include <rg/GLDebug.h>
+
+#include <chrono>
+#include <thread>
+
+namespace rg {
+
+// Frame pacing with fences (core since 3.2). Every frame ends with a fence; beginFrame() blocks until no
+// more than maxFramesInFlight - 1 frames are still queued on the GPU, so the frame about to be built is
+// never more than that behind the input. The limiter sleeps to a fixed frame rate and spins the last
+// stretch, a sleep alone oversleeps by up to a scheduler tick.
+// Input to present latency: the time of the first input a frame picked up (latchInput, handed to
+// endFrame) against the moment its fence is seen signaled, which is when the GPU finished the frame including the swap's copy
+// or flip request. Without the cap the fences are only looked at once per frame, which can add up to a
+// frame to the measurement; scanout on a vsynced display comes on top in either case.
+// The fences of the last frames live as long as the context. inputArrived() and latchInput() belong to the
+// thread handling input, everything else to the one with the context.
+class FramePacer {
+public:
+    // fences tracked without the cap; a driver queueing more than this drops measurements, not frames
+    static const unsigned int MAX_TRACKED_FRAMES = 8;
+    // weight of a new latency sample in the average
+    static constexpr float SMOOTHING = 0.1f;
+    // how long the limiter sleeps short of the deadline before spinning
+    static constexpr double SPIN_SECONDS = 0.002;
+
+    // 0 leaves the queue depth to the driver
+    unsigned int maxFramesInFlight = 0;
+    // frames per second, 0 for no limit
+    double frameLimit = 0.0;
+
+    static double now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // before the frame's CPU work (and before polling input)
+    void beginFrame() {
+        retireSignaled();
+        unsigned int cap = maxFramesInFlight;
+        if (cap > 0) {
+            while (m_Count >= cap) {
+                GLenum result = glClientWaitSync(m_Frames[m_First].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);//100 ms
+                glCalls().count(GL_CALL_QUERY);
+                if (result == GL_TIMEOUT_EXPIRED)
+                    continue;
+                retire();//signaled, or an error that would never signal
+            }
+        }
+        if (frameLimit > 0.0) {
+            double period = 1.0 / frameLimit;
+            double time = now();
+            if (m_NextFrame < time - period)
+                m_NextFrame = time;//fell behind, no catching up with a burst of frames
+            double sleep = m_NextFrame - time - SPIN_SECONDS;
+            if (sleep > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+            while (now() < m_NextFrame) {
+            }
+            m_NextFrame += period;
+        }
+    }
+
+    // from the input callbacks; only the first input before a frame latches counts
+    void inputArrived() {
+        if (m_PendingInput < 0.0)
+            m_PendingInput = now();
+    }
+
+    // right before the frame takes the camera; the time of its first input, -1 if it has none
+    double latchInput() {
+        double input = m_PendingInput;
+        m_PendingInput = -1.0;
+        return input;
+    }
+
+    // right after the swap, with the frame's latchInput()
+    void endFrame(double inputTime) {
+        if (m_Count == MAX_TRACKED_FRAMES) {
+            glDeleteSync(m_Frames[m_First].fence);
+            pop();
+        }
+        InFlight& frame = m_Frames[(m_First + m_Count) % MAX_TRACKED_FRAMES];
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.inputTime = inputTime;
+        glCalls().count(GL_CALL_QUERY);
+        m_Count++;
+        retireSignaled();
+    }
+
+    // smoothed, 0 until a frame with input was presented
+    float inputLatencyMs() const {
+        return m_InputLatencyMs;
+    }
+
+    unsigned int framesInFlight() const {
+        return m_Count;
+    }
+
+private:
+    struct InFlight {
+        GLsync fence;
+        double inputTime;
+    };
+    InFlight m_Frames[MAX_TRACKED_FRAMES];
+    unsigned int m_First = 0;
+    unsigned int m_Count = 0;
+    double m_PendingInput = -1.0;
+    double m_NextFrame = 0.0;
+    float m_InputLatencyMs = 0.0f;
+
+    void retireSignaled() {
+        while (m_Count > 0) {
+            GLenum result = glClientWaitSync(m_Frames[m_First].fence, 0, 0);
+            glCalls().count(GL_CALL_QUERY);
+            if (result == GL_TIMEOUT_EXPIRED)
+                return;
+            retire();
+        }
+    }
+
+    // the oldest frame is done
+    void retire() {
+        InFlight& frame = m_Frames[m_First];
+        if (frame.inputTime >= 0.0) {
+            float latency = (float)((now() - frame.inputTime) * 1000.0);
+            m_InputLatencyMs = m_InputLatencyMs == 0.0f ? latency : m_InputLatencyMs + (latency - m_InputLatencyMs) * SMOOTHING;
+        }
+        glDeleteSync(frame.fence);
+        pop();
+    }
+
+    void pop() {
+        m_First = (m_First + 1) % MAX_TRACKED_FRAMES;
+        m_Count--;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_FRAMEPACER_H
@@ -0,0 +1,155 @@
+#ifndef PROJECT_BASE_GLDEBUG_H
+#define PROJECT_BASE_GLDEBUG_H
+
+#include <glad/glad.h>
+#include <rg/GLExtensions.h>
+
+#include <atomic>
+#include <iostream>
+
+// Debug output, object labels and debug groups (KHR_debug). On by default, builds with NDEBUG (release)
+// compile it all down to empty functions; -DRG_GL_DEBUG=0/1 overrides that.
+#ifndef RG_GL_DEBUG
+#ifdef NDEBUG
+#define RG_GL_DEBUG 0
+#else
+#define RG_GL_DEBUG 1
+#endif
+#endif
+
+namespace rg {
+
+enum GLCallCategory {
+    GL_CALL_STATE = 0,   // binds and fixed function state, as issued by GLState
+    GL_CALL_UNIFORM = 1, // Shader::set*, a location lookup plus the upload each
+    GL_CALL_DRAW = 2,    // draws and compute dispatches
+    GL_CALL_QUERY = 3,   // timer and statistics queries
+    GL_CALL_CATEGORY_COUNT = 4
+};
+
+const char* const GL_CALL_CATEGORY_NAMES[GL_CALL_CATEGORY_COUNT] = {"state", "uniform", "draw", "query"};
+
+struct GLCallCounters {
+    unsigned int calls[GL_CALL_CATEGORY_COUNT] = {0};
+    unsigned int triangles = 0;
+
+    unsigned int total() const {
+        unsigned int sum = 0;
+        for (unsigned int count : calls)
+            sum += count;
+        return sum;
+    }
+};
+
+// GL calls per frame by category, counted where the renderer issues them (ImGui's own are not). Only
+// increments, so it stays on in release builds, where driver overhead is worth watching the most.
+class GLCallCounter {
+public:
+    GLCallCounters lastFrame;
+
+    void count(GLCallCategory category, unsigned int calls = 1) {
+        m_Counters.calls[category] += calls;
+    }
+
+    void countDraw(unsigned int triangles) {
+        m_Counters.calls[GL_CALL_DRAW]++;
+        m_Counters.triangles += triangles;
+    }
+
+    // moves the current counters to lastFrame; call once per frame
+    void endFrame() {
+        lastFrame = m_Counters;
+        m_Counters = GLCallCounters();
+    }
+
+private:
+    GLCallCounters m_Counters;
+};
+
+GLCallCounter& glCalls() {
+    static GLCallCounter counter;
+    return counter;
+}
+
+// errors the driver reported since startup, through the debug callback
+std::atomic<unsigned int>& glDebugErrors() {
+    static std::atomic<unsigned int> errors(0);
+    return errors;
+}
+
+bool glDebugOutputEnabled() {
+#if RG_GL_DEBUG
+    return glExtensions().debugOutput;
+#else
+    return false;
+#endif
+}
+
+#if RG_GL_DEBUG
+const char* debugTypeName(GLenum type) {
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        default: return "other";
+    }
+}
+
+// Asynchronous output: the driver may call this later and from its own thread, so it only prints and
+// counts. Group pushes and pops of our own are not worth a line.
+void APIENTRY glDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                              const GLchar* message, const void* userParam) {
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP)
+        return;
+    if (type == GL_DEBUG_TYPE_ERROR)
+        glDebugErrors()++;
+    std::cerr << "[OpenGL " << debugTypeName(type) << (severity == GL_DEBUG_SEVERITY_HIGH ? ", high" : "")
+              << "] " << id << ": " << message << '\n';
+}
+#endif
+
+// call once after loadGLExtensions; replaces glGetError polling (see GLCALL) where KHR_debug is there.
+// Notifications are left out, drivers send one for every buffer placement.
+void enableGLDebugOutput() {
+#if RG_GL_DEBUG
+    const GLExtensions& ext = glExtensions();
+    if (!ext.debugOutput)
+        return;
+    glEnable(GL_DEBUG_OUTPUT);
+    ext.DebugMessageCallback(glDebugCallback, nullptr);
+    ext.DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+#endif
+}
+
+// names objects in the debug output and in frame debuggers; identifier is GL_TEXTURE, GL_FRAMEBUFFER,
+// GL_PROGRAM, GL_BUFFER, ...
+void labelGLObject(GLenum identifier, GLuint name, const char* label) {
+#if RG_GL_DEBUG
+    const GLExtensions& ext = glExtensions();
+    if (ext.debugOutput && name != 0)
+        ext.ObjectLabel(identifier, name, -1, label);
+#endif
+}
+
+// groups the calls up to the matching pop under name in frame debuggers; groups nest
+void pushGLDebugGroup(const char* name) {
+#if RG_GL_DEBUG
+    const GLExtensions& ext = glExtensions();
+    if (ext.debugOutput)
+        ext.PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+#endif
+}
+
+void popGLDebugGroup() {
+#if RG_GL_DEBUG
+    const GLExtensions& ext = glExtensions();
+    if (ext.debugOutput)
+        ext.PopDebugGroup();
+#endif
+}
+
+}
+
+#endif //PROJECT_BASE_GLDEBUG_H
@@ -0,0 +1,197 @@
+#ifndef PROJECT_BASE_GLEXTENSIONS_H
+#define PROJECT_BASE_GLEXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad in libs/ is generated for plain GL 3.3 core. Everything newer that is used optionally is declared
+// and loaded here; every feature has a flag that is false when the context does not offer it.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_VERTEX_SHADER_INVOCATIONS
+#define GL_VERTEX_SHADER_INVOCATIONS 0x82F0
+#endif
+#ifndef GL_FRAGMENT_SHADER_INVOCATIONS
+#define GL_FRAGMENT_SHADER_INVOCATIONS 0x82F4
+#endif
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_SOURCE_APPLICATION
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#endif
+#ifndef GL_DEBUG_TYPE_ERROR
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#endif
+#ifndef GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#endif
+#ifndef GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#endif
+#ifndef GL_DEBUG_TYPE_PORTABILITY
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#endif
+#ifndef GL_DEBUG_TYPE_PERFORMANCE
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#endif
+#ifndef GL_DEBUG_TYPE_PUSH_GROUP
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#endif
+#ifndef GL_DEBUG_TYPE_POP_GROUP
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#endif
+#ifndef GL_DEBUG_SEVERITY_HIGH
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#endif
+#ifndef GL_DEBUG_SEVERITY_MEDIUM
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#endif
+#ifndef GL_DEBUG_SEVERITY_LOW
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#endif
+#ifndef GL_DEBUG_SEVERITY_NOTIFICATION
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+#ifndef GL_BUFFER
+#define GL_BUFFER 0x82E0
+#endif
+#ifndef GL_PROGRAM
+#define GL_PROGRAM 0x82E2
+#endif
+#ifndef GL_VERTEX_ARRAY
+#define GL_VERTEX_ARRAY 0x8074
+#endif
+
+namespace rg {
+
+struct GLExtensions {
+    int majorVersion = 0;
+    int minorVersion = 0;
+
+    // GL 4.1 / ARB_get_program_binary
+    bool programBinary = false;
+    void (APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) = nullptr;
+    void (APIENTRYP ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) = nullptr;
+    void (APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value) = nullptr;
+
+    // KHR_parallel_shader_compile (or the ARB flavour, which shares the enums)
+    bool parallelShaderCompile = false;
+    void (APIENTRYP MaxShaderCompilerThreads)(GLuint count) = nullptr;
+
+    // GL 4.3 compute shaders, with the shader storage buffers and image stores that come with them
+    bool computeShader = false;
+    void (APIENTRYP DispatchCompute)(GLuint groupsX, GLuint groupsY, GLuint groupsZ) = nullptr;
+    void (APIENTRYP MemoryBarrierGL)(GLbitfield barriers) = nullptr; // MemoryBarrier is a macro in windows.h
+    void (APIENTRYP BindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) = nullptr;
+
+    // GL 4.6 / ARB_pipeline_statistics_query, only new query targets for glBeginQuery
+    bool pipelineStatistics = false;
+
+    // GL 4.3 / KHR_debug
+    bool debugOutput = false;
+    void (APIENTRYP DebugMessageCallback)(GLDEBUGPROC callback, const void* userParam) = nullptr;
+    void (APIENTRYP DebugMessageControl)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled) = nullptr;
+    void (APIENTRYP ObjectLabel)(GLenum identifier, GLuint name, GLsizei length, const GLchar* label) = nullptr;
+    void (APIENTRYP PushDebugGroup)(GLenum source, GLuint id, GLsizei length, const GLchar* message) = nullptr;
+    void (APIENTRYP PopDebugGroup)() = nullptr;
+};
+
+GLExtensions& glExtensions() {
+    static GLExtensions extensions;
+    return extensions;
+}
+
+bool hasGLVersion(int major, int minor) {
+    const GLExtensions& ext = glExtensions();
+    return ext.majorVersion > major || (ext.majorVersion == major && ext.minorVersion >= minor);
+}
+
+bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != nullptr && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// call once after gladLoadGLLoader, with the same loader
+void loadGLExtensions(GLADloadproc load) {
+    GLExtensions& ext = glExtensions();
+    glGetIntegerv(GL_MAJOR_VERSION, &ext.majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &ext.minorVersion);
+
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+        ext.GetProgramBinary = (decltype(ext.GetProgramBinary)) load("glGetProgramBinary");
+        ext.ProgramBinary = (decltype(ext.ProgramBinary)) load("glProgramBinary");
+        ext.ProgramParameteri = (decltype(ext.ProgramParameteri)) load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (decltype(ext.MaxShaderCompilerThreads)) load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (decltype(ext.MaxShaderCompilerThreads)) load("glMaxShaderCompilerThreadsARB");
+    ext.parallelShaderCompile = ext.MaxShaderCompilerThreads != nullptr;
+    if (ext.parallelShaderCompile)
+        ext.MaxShaderCompilerThreads(0xFFFFFFFF); // as many threads as the driver likes
+
+    if (hasGLVersion(4, 3)) {
+        ext.DispatchCompute = (decltype(ext.DispatchCompute)) load("glDispatchCompute");
+        ext.MemoryBarrierGL = (decltype(ext.MemoryBarrierGL)) load("glMemoryBarrier");
+        ext.BindImageTexture = (decltype(ext.BindImageTexture)) load("glBindImageTexture");
+        ext.computeShader = ext.DispatchCompute && ext.MemoryBarrierGL && ext.BindImageTexture;
+    }
+
+    ext.pipelineStatistics = hasGLVersion(4, 6) || hasGLExtension("GL_ARB_pipeline_statistics_query");
+
+    // in a desktop GL context the KHR_debug entry points have no suffix
+    if (hasGLVersion(4, 3) || hasGLExtension("GL_KHR_debug")) {
+        ext.DebugMessageCallback = (decltype(ext.DebugMessageCallback)) load("glDebugMessageCallback");
+        ext.DebugMessageControl = (decltype(ext.DebugMessageControl)) load("glDebugMessageControl");
+        ext.ObjectLabel = (decltype(ext.ObjectLabel)) load("glObjectLabel");
+        ext.PushDebugGroup = (decltype(ext.PushDebugGroup)) load("glPushDebugGroup");
+        ext.PopDebugGroup = (decltype(ext.PopDebugGroup)) load("glPopDebugGroup");
+        ext.debugOutput = ext.DebugMessageCallback && ext.DebugMessageControl && ext.ObjectLabel
+                          && ext.PushDebugGroup && ext.PopDebugGroup;
+    }
+}
+
+}
+
+#endif //PROJECT_BASE_GLEXTENSIONS_H
@@ -0,0 +1,243 @@
+#ifndef PROJECT_BASE_GLSTATE_H
+#define PROJECT_BASE_GLSTATE_H
+
+#include <glad/glad.h>
+#include <rg/GLDebug.h>
+
+namespace rg {
+
+struct GLStateCounters {
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+    // part of issued
+    unsigned int programBinds = 0;
+    unsigned int textureBinds = 0;
+};
+
+// Shadow copy of the GL state the renderer touches. Every setter compares against the mirrored value and
+// only reaches the driver when something really changes. Code that changes the same state behind the
+// cache's back (third party libraries, loaders) has to be followed by invalidate().
+class GLState {
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    GLState() {
+        invalidate();
+    }
+
+    // forget everything, the next call of every setter goes to the driver
+    void invalidate() {
+        m_Program = INVALID;
+        m_VertexArray = INVALID;
+        m_Framebuffer = INVALID;
+        m_ActiveUnit = INVALID;
+        for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            m_Texture2D[i] = INVALID;
+            m_TextureCube[i] = INVALID;
+        }
+        m_Blend = m_DepthTest = m_CullFace = -1;
+        m_BlendSrc = m_BlendDst = INVALID;
+        m_DepthFunc = INVALID;
+        m_DepthMask = -1;
+        m_ColorMask = -1;
+    }
+
+    // a deleted name can be handed out again by GL, so it must not stay mirrored as bound
+    void forgetProgram(unsigned int program) {
+        if (m_Program == program)
+            m_Program = INVALID;
+    }
+
+    void forgetTexture(unsigned int texture) {
+        for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            if (m_Texture2D[i] == texture)
+                m_Texture2D[i] = INVALID;
+            if (m_TextureCube[i] == texture)
+                m_TextureCube[i] = INVALID;
+        }
+    }
+
+    // moves the current counters to lastFrame; call once per frame
+    void endFrame() {
+        lastFrame = m_Counters;
+        m_Counters = GLStateCounters();
+    }
+
+    GLStateCounters lastFrame;
+
+    const GLStateCounters& currentFrame() const {
+        return m_Counters;
+    }
+
+    // returns true if the program actually changed
+    bool useProgram(unsigned int program) {
+        if (skip(m_Program == program))
+            return false;
+        glUseProgram(program);
+        m_Program = program;
+        m_Counters.programBinds++;
+        return true;
+    }
+
+    void bindVertexArray(unsigned int vertexArray) {
+        if (skip(m_VertexArray == vertexArray))
+            return;
+        glBindVertexArray(vertexArray);
+        m_VertexArray = vertexArray;
+    }
+
+    void bindFramebuffer(unsigned int framebuffer) {
+        if (skip(m_Framebuffer == framebuffer))
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        m_Framebuffer = framebuffer;
+    }
+
+    void activeTexture(unsigned int unit) {
+        if (skip(m_ActiveUnit == unit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_ActiveUnit = unit;
+    }
+
+    // binds to the currently active unit
+    void bindTexture(GLenum target, unsigned int texture) {
+        unsigned int* bound = boundTexture(target);
+        if (bound == nullptr) {
+            countIssued();
+            m_Counters.textureBinds++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (skip(*bound == texture))
+            return;
+        glBindTexture(target, texture);
+        *bound = texture;
+        m_Counters.textureBinds++;
+    }
+
+    // binds to the given unit, switching the active unit only when the texture is not there yet
+    void bindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+        unsigned int* bound = boundTexture(target, unit);
+        if (bound != nullptr && *bound == texture) {
+            m_Counters.skipped++;
+            return;
+        }
+        activeTexture(unit);
+        bindTexture(target, texture);
+    }
+
+    // only GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are mirrored, anything else goes straight through
+    void enable(GLenum capability) {
+        setCapability(capability, true);
+    }
+
+    void disable(GLenum capability) {
+        setCapability(capability, false);
+    }
+
+    void blendFunc(GLenum src, GLenum dst) {
+        if (skip(m_BlendSrc == src && m_BlendDst == dst))
+            return;
+        glBlendFunc(src, dst);
+        m_BlendSrc = src;
+        m_BlendDst = dst;
+    }
+
+    void depthFunc(GLenum func) {
+        if (skip(m_DepthFunc == func))
+            return;
+        glDepthFunc(func);
+        m_DepthFunc = func;
+    }
+
+    void depthMask(bool write) {
+        if (skip(m_DepthMask == (int)write))
+            return;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+        m_DepthMask = write;
+    }
+
+    // all four channels at once, nothing here needs more
+    void colorMask(bool write) {
+        if (skip(m_ColorMask == (int)write))
+            return;
+        GLboolean value = write ? GL_TRUE : GL_FALSE;
+        glColorMask(value, value, value, value);
+        m_ColorMask = write;
+    }
+
+private:
+    static const unsigned int INVALID = ~0u;
+
+    GLStateCounters m_Counters;
+
+    unsigned int m_Program;
+    unsigned int m_VertexArray;
+    unsigned int m_Framebuffer;
+    unsigned int m_ActiveUnit;
+    unsigned int m_Texture2D[MAX_TEXTURE_UNITS];
+    unsigned int m_TextureCube[MAX_TEXTURE_UNITS];
+    int m_Blend;
+    int m_DepthTest;
+    int m_CullFace;
+    unsigned int m_BlendSrc;
+    unsigned int m_BlendDst;
+    unsigned int m_DepthFunc;
+    int m_DepthMask;
+    int m_ColorMask;
+
+    bool skip(bool redundant) {
+        if (redundant)
+            m_Counters.skipped++;
+        else
+            countIssued();
+        return redundant;
+    }
+
+    void countIssued() {
+        m_Counters.issued++;
+        glCalls().count(GL_CALL_STATE);
+    }
+
+    unsigned int* boundTexture(GLenum target) {
+        return m_ActiveUnit < MAX_TEXTURE_UNITS ? boundTexture(target, m_ActiveUnit) : nullptr;
+    }
+
+    unsigned int* boundTexture(GLenum target, unsigned int unit) {
+        if (unit >= MAX_TEXTURE_UNITS)
+            return nullptr;
+        if (target == GL_TEXTURE_2D)
+            return &m_Texture2D[unit];
+        if (target == GL_TEXTURE_CUBE_MAP)
+            return &m_TextureCube[unit];
+        return nullptr;
+    }
+
+    void setCapability(GLenum capability, bool enabled) {
+        int* mirrored = capability == GL_BLEND ? &m_Blend
+                      : capability == GL_DEPTH_TEST ? &m_DepthTest
+                      : capability == GL_CULL_FACE ? &m_CullFace
+                      : nullptr;
+        if (mirrored != nullptr && skip(*mirrored == (int)enabled))
+            return;
+        if (mirrored == nullptr)
+            countIssued();
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        if (mirrored != nullptr)
+            *mirrored = enabled;
+    }
+};
+
+// the one cache for the one GL context of the application
+GLState& glState() {
+    static GLState state;
+    return state;
+}
+
+}
+
+#endif //PROJECT_BASE_GLSTATE_H
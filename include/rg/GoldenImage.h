@@ -0,0 +1,121 @@
+#ifndef PROJECT_BASE_GOLDENIMAGE_H
+#define PROJECT_BASE_GOLDENIMAGE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// 8 bit sRGB, rows top to bottom
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb;
+};
+
+// binary PPM (P6): no dependency for writing, and diffable with any image tool
+bool writePpm(const std::string& path, const Image& image) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+    bool written = std::fwrite(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+    std::fclose(file);
+    return written;
+}
+
+// only what writePpm produces, no comments in the header
+bool readPpm(const std::string& path, Image& image) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    int maxValue = 0;
+    bool read = std::fscanf(file, "P6 %d %d %d", &image.width, &image.height, &maxValue) == 3 && maxValue == 255
+                && std::fgetc(file) != EOF && image.width > 0 && image.height > 0;
+    if (read) {
+        image.rgb.resize((size_t)image.width * image.height * 3);
+        read = std::fread(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+    }
+    std::fclose(file);
+    return read;
+}
+
+// the color buffer of the bound draw framebuffer (the back buffer for the window), flipped to top down
+Image readFramebuffer(int width, int height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize((size_t)width * height * 3);
+    std::vector<unsigned char> bottomUp(image.rgb.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, bottomUp.data());
+    size_t row = (size_t)width * 3;
+    for (int y = 0; y < height; y++)
+        std::copy(bottomUp.begin() + (height - 1 - y) * row, bottomUp.begin() + (height - y) * row, image.rgb.begin() + y * row);
+    return image;
+}
+
+struct ImageDifference {
+    bool comparable = false; // same size
+    float meanDeltaE = 0.0f;
+    float maxDeltaE = 0.0f;
+    // share of the pixels that differ by more than the tolerance
+    float failingShare = 0.0f;
+};
+
+// CIELAB of an 8 bit sRGB color (D65 white)
+void srgbToLab(const unsigned char* rgb, float lab[3]) {
+    static float linear[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        initialized = true;
+    }
+    float r = linear[rgb[0]], g = linear[rgb[1]], b = linear[rgb[2]];
+    float xyz[3] = {(0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f,
+                    0.2126f * r + 0.7152f * g + 0.0722f * b,
+                    (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f};
+    for (float& v : xyz)
+        v = v > 0.008856f ? std::cbrt(v) : 7.787f * v + 16.0f / 116.0f;
+    lab[0] = 116.0f * xyz[1] - 16.0f;
+    lab[1] = 500.0f * (xyz[0] - xyz[1]);
+    lab[2] = 200.0f * (xyz[1] - xyz[2]);
+}
+
+// Perceptual difference per pixel as CIE76 delta E, where about 2.3 is the smallest difference people
+// notice side by side. Pixels above deltaETolerance count as failing.
+ImageDifference compareImages(const Image& reference, const Image& test, float deltaETolerance) {
+    ImageDifference difference;
+    if (reference.width != test.width || reference.height != test.height || reference.rgb.size() != test.rgb.size())
+        return difference;
+    difference.comparable = true;
+    size_t pixels = (size_t)reference.width * reference.height;
+    if (pixels == 0)
+        return difference;
+    double sum = 0.0;
+    size_t failing = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        float a[3], b[3];
+        srgbToLab(&reference.rgb[i * 3], a);
+        srgbToLab(&test.rgb[i * 3], b);
+        float deltaE = std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+        sum += deltaE;
+        difference.maxDeltaE = std::max(difference.maxDeltaE, deltaE);
+        failing += deltaE > deltaETolerance;
+    }
+    difference.meanDeltaE = (float)(sum / pixels);
+    difference.failingShare = (float)failing / pixels;
+    return difference;
+}
+
+}
+
+#endif //PROJECT_BASE_GOLDENIMAGE_H
@@ -0,0 +1,28 @@
+#ifndef PROJECT_BASE_GPUMEMORY_H
+#define PROJECT_BASE_GPUMEMORY_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace rg {
+
+// GPU memory of the loaded assets, estimated from sizes and formats where they are uploaded (drivers pad
+// and align on top). Render targets are counted by their pool. Atomic, the upload context adds from its thread.
+struct GpuMemory {
+    std::atomic<uint64_t> textureBytes{0};
+    std::atomic<uint64_t> bufferBytes{0};
+};
+
+GpuMemory& gpuMemory() {
+    static GpuMemory memory;
+    return memory;
+}
+
+// a full mip chain adds a third to the base level
+uint64_t mipmappedTextureBytes(int width, int height, unsigned int bytesPerPixel) {
+    return (uint64_t)width * height * bytesPerPixel * 4 / 3;
+}
+
+}
+
+#endif //PROJECT_BASE_GPUMEMORY_H
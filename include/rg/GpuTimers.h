@@ -0,0 +1,155 @@
+#ifndef PROJECT_BASE_GPUTIMERS_H
+#define PROJECT_BASE_GPUTIMERS_H
+
+#include <glad/glad.h>
+#include <rg/GLDebug.h>
+#include <rg/GLExtensions.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace rg {
+
+struct PassTiming {
+    const char* pass;
+    // smoothed over the last frames
+    double milliseconds;
+    // of the newest frame with results, 0 while pipeline statistics are off
+    uint64_t vertexInvocations;
+    uint64_t fragmentInvocations;
+};
+
+// GPU time per render pass with GL_TIME_ELAPSED queries (core since 3.3). Every pass has a query per
+// frame in flight and results are read LATENCY frames later, when the GPU is long done with them, so
+// measuring never waits. Passes can not nest; a pass that was not measured for LATENCY frames (turned
+// off) drops out of the results.
+// With pipelineStatistics set every pass also counts its vertex and fragment shader invocations, which
+// needs glExtensions().pipelineStatistics. Every pass is a debug group of the same name as well.
+// The query objects live as long as the context.
+class GpuTimers {
+public:
+    static const unsigned int LATENCY = 3;
+
+    bool pipelineStatistics = false;
+
+    // call once per frame before the first begin(); collects the results of LATENCY frames ago
+    void beginFrame() {
+        m_Frame = (m_Frame + 1) % LATENCY;
+        m_FrameCount++;
+        for (Pass& pass : m_Passes) {
+            if (!pass.issued[m_Frame])
+                continue;
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(pass.queries[m_Frame], GL_QUERY_RESULT_AVAILABLE, &available);
+            glCalls().count(GL_CALL_QUERY);
+            if (!available)
+                continue; // GPU more than LATENCY frames behind; this sample is skipped, never waited for
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(pass.queries[m_Frame], GL_QUERY_RESULT, &nanoseconds);
+            glCalls().count(GL_CALL_QUERY);
+            pass.issued[m_Frame] = false;
+            double milliseconds = nanoseconds / 1.0e6;
+            pass.milliseconds = pass.measured ? pass.milliseconds + (milliseconds - pass.milliseconds) * SMOOTHING : milliseconds;
+            pass.measured = true;
+
+            // issued together with the time query, so done by now too
+            pass.vertexInvocations = 0;
+            pass.fragmentInvocations = 0;
+            if (pass.statisticsIssued[m_Frame]) {
+                glGetQueryObjectui64v(pass.vertexQueries[m_Frame], GL_QUERY_RESULT, &pass.vertexInvocations);
+                glGetQueryObjectui64v(pass.fragmentQueries[m_Frame], GL_QUERY_RESULT, &pass.fragmentInvocations);
+                glCalls().count(GL_CALL_QUERY, 2);
+            }
+        }
+    }
+
+    // name has to stay valid (a string literal)
+    void begin(const char* name) {
+        pushGLDebugGroup(name);
+        Pass& pass = find(name);
+        pass.issued[m_Frame] = true;
+        pass.lastFrame = m_FrameCount;
+        glBeginQuery(GL_TIME_ELAPSED, pass.queries[m_Frame]);
+        // queries of different targets may run at the same time
+        m_StatisticsActive = pipelineStatistics;
+        pass.statisticsIssued[m_Frame] = pipelineStatistics;
+        if (pipelineStatistics) {
+            glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS, pass.vertexQueries[m_Frame]);
+            glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, pass.fragmentQueries[m_Frame]);
+        }
+        glCalls().count(GL_CALL_QUERY, pipelineStatistics ? 3 : 1);
+    }
+
+    void end() {
+        glEndQuery(GL_TIME_ELAPSED);
+        if (m_StatisticsActive) {
+            glEndQuery(GL_VERTEX_SHADER_INVOCATIONS);
+            glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+        }
+        glCalls().count(GL_CALL_QUERY, m_StatisticsActive ? 3 : 1);
+        popGLDebugGroup();
+    }
+
+    // passes in the order they were first measured
+    std::vector<PassTiming> results() const {
+        std::vector<PassTiming> timings;
+        for (const Pass& pass : m_Passes) {
+            if (current(pass))
+                timings.push_back({pass.name, pass.milliseconds, pass.vertexInvocations, pass.fragmentInvocations});
+        }
+        return timings;
+    }
+
+    double totalMilliseconds() const {
+        double total = 0.0;
+        for (const Pass& pass : m_Passes) {
+            if (current(pass))
+                total += pass.milliseconds;
+        }
+        return total;
+    }
+
+private:
+    static constexpr double SMOOTHING = 0.1;
+
+    struct Pass {
+        const char* name;
+        GLuint queries[LATENCY];
+        bool issued[LATENCY];
+        bool measured;
+        double milliseconds;
+        unsigned long long lastFrame;
+        GLuint vertexQueries[LATENCY];
+        GLuint fragmentQueries[LATENCY];
+        bool statisticsIssued[LATENCY];
+        GLuint64 vertexInvocations;
+        GLuint64 fragmentInvocations;
+    };
+
+    std::vector<Pass> m_Passes;
+    unsigned int m_Frame = 0;
+    unsigned long long m_FrameCount = 0;
+    bool m_StatisticsActive = false;
+
+    bool current(const Pass& pass) const {
+        return pass.measured && m_FrameCount - pass.lastFrame <= LATENCY;
+    }
+
+    Pass& find(const char* name) {
+        for (Pass& pass : m_Passes) {
+            if (pass.name == name || std::strcmp(pass.name, name) == 0)
+                return pass;
+        }
+        Pass pass{name, {0}, {false}, false, 0.0, m_FrameCount, {0}, {0}, {false}, 0, 0};
+        glGenQueries(LATENCY, pass.queries);
+        glGenQueries(LATENCY, pass.vertexQueries);
+        glGenQueries(LATENCY, pass.fragmentQueries);
+        m_Passes.push_back(pass);
+        return m_Passes.back();
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_GPUTIMERS_H
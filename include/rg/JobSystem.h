@@ -0,0 +1,292 @@
+#ifndef PROJECT_BASE_JOBSYSTEM_H
+#define PROJECT_BASE_JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace rg {
+
+// names the calling thread for debuggers and profilers (gdb, perf, RenderDoc); Linux keeps 15 characters
+void setThreadName(const char* name) {
+#ifdef __linux__
+    pthread_setname_np(pthread_self(), name);
+#else
+    (void)name;
+#endif
+}
+
+class Job;
+using JobHandle = std::shared_ptr<Job>;
+
+// A unit of work of the JobSystem. It runs once every job it depends on finished.
+class Job {
+public:
+    bool finished() const {
+        return m_Finished.load(std::memory_order_acquire);
+    }
+
+private:
+    friend class JobSystem;
+
+    std::function<void()> m_Work;
+    // unfinished dependencies, plus one while the job is being scheduled
+    std::atomic<unsigned int> m_Blockers{1};
+    std::atomic<bool> m_Finished{false};
+    std::mutex m_Mutex;// guards m_Dependents against the job finishing
+    std::vector<JobHandle> m_Dependents;
+};
+
+struct JobSystemStats {
+    unsigned int workers = 0;
+    unsigned int executed = 0;
+    unsigned int stolen = 0;// taken from another thread's deque
+};
+
+// Work-stealing scheduler. Every worker owns a deque: it pushes the jobs it schedules to the back and
+// takes its own work from there (newest first, the data is still in its cache), while idle threads steal
+// from the front (oldest first, usually the biggest piece left). Jobs scheduled from other threads go to
+// a shared deque anyone takes from. A thread waiting for a job runs other jobs meanwhile, so waiting
+// inside a job never blocks a worker. Without workers jobs only run inside wait(), so a job nobody waits
+// for needs at least one.
+// The deques are short-lived and lightly contended, a mutex each is cheaper here than getting a
+// lock-free deque right. Jobs must not throw.
+class JobSystem {
+public:
+    // empty rounds a waiting thread yields for before it sleeps; a job about to finish is not worth a sleep
+    static const unsigned int WAIT_SPINS = 64;
+
+    explicit JobSystem(unsigned int workers)
+        : m_WorkerCount(workers) {
+        for (unsigned int i = 0; i <= workers; i++)
+            m_Queues.emplace_back(new Queue());
+        for (unsigned int i = 0; i < workers; i++)
+            m_Threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    // jobs still queued are dropped
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_all();
+        for (std::thread& thread : m_Threads)
+            thread.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int workerCount() const {
+        return m_WorkerCount;
+    }
+
+    // work runs on some thread once every dependency finished
+    JobHandle schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies = {}) {
+        JobHandle job = std::make_shared<Job>();
+        job->m_Work = std::move(work);
+        for (const JobHandle& dependency : dependencies) {
+            std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+            if (!dependency->finished()) {
+                job->m_Blockers.fetch_add(1, std::memory_order_relaxed);
+                dependency->m_Dependents.push_back(job);
+            }
+        }
+        release(job);
+        return job;
+    }
+
+    // runs other jobs on the calling thread until job finished; with nothing to run it sleeps until a job
+    // finishes or another is queued
+    void wait(const JobHandle& job) {
+        unsigned int idle = 0;
+        while (!job->finished()) {
+            if (runOne(currentQueue())) {
+                idle = 0;
+            } else if (++idle < WAIT_SPINS) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lock(m_SleepMutex);
+                m_Waiters++;
+                m_Changed.wait(lock, [&]() { return job->finished() || m_Queued.load() > 0; });
+                m_Waiters--;
+                idle = 0;
+            }
+        }
+    }
+
+    // body(i) for every i in [begin, end), grain indices per job; the calling thread takes the first chunk
+    // and helps with the rest
+    template<typename Body>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+        if (begin >= end)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        size_t firstEnd = std::min(begin + grain, end);
+        std::vector<JobHandle> chunks;
+        for (size_t first = firstEnd; first < end; first += grain) {
+            size_t last = std::min(first + grain, end);
+            chunks.push_back(schedule([&body, first, last]() {
+                for (size_t i = first; i < last; i++)
+                    body(i);
+            }));
+        }
+        for (size_t i = begin; i < firstEnd; i++)
+            body(i);
+        for (const JobHandle& chunk : chunks)
+            wait(chunk);
+    }
+
+    JobSystemStats stats() const {
+        JobSystemStats stats;
+        stats.workers = workerCount();
+        for (const std::unique_ptr<Queue>& queue : m_Queues) {
+            stats.executed += queue->executed.load(std::memory_order_relaxed);
+            stats.stolen += queue->stolen.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+        // by the threads taking from this queue
+        std::atomic<unsigned int> executed{0};
+        std::atomic<unsigned int> stolen{0};
+    };
+    // the worker's index in the system it belongs to; other threads use the shared queue, the last one
+    struct ThreadQueue {
+        const JobSystem* system = nullptr;
+        unsigned int index = 0;
+    };
+
+    // set before the threads start, which read it
+    const unsigned int m_WorkerCount;
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Threads;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_Wake;
+    // threads sleeping in wait(), woken by every finished or queued job; guarded by m_SleepMutex
+    std::condition_variable m_Changed;
+    unsigned int m_Waiters = 0;
+    std::atomic<unsigned int> m_Queued{0};
+    bool m_Stop = false;
+
+    static ThreadQueue& threadQueue() {
+        static thread_local ThreadQueue queue;
+        return queue;
+    }
+
+    unsigned int currentQueue() const {
+        const ThreadQueue& queue = threadQueue();
+        return queue.system == this ? queue.index : workerCount();
+    }
+
+    void workerLoop(unsigned int index) {
+        threadQueue() = {this, index};
+        setThreadName(("rg-worker-" + std::to_string(index)).c_str());
+        while (true) {
+            if (runOne(index))
+                continue;
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            m_Wake.wait(lock, [this]() { return m_Stop || m_Queued.load() > 0; });
+            if (m_Stop)
+                return;
+        }
+    }
+
+    // drops the scheduling reference, queues the job once nothing blocks it any more
+    void release(const JobHandle& job) {
+        if (job->m_Blockers.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        Queue& queue = *m_Queues[currentQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        m_Queued.fetch_add(1);
+        bool waiters = sleepingWaiters();
+        m_Wake.notify_one();
+        if (waiters)
+            m_Changed.notify_all();
+    }
+
+    // whether threads sleep in wait(); taking the lock orders what changed before (a count, a finished
+    // flag) before the check of a thread about to sleep
+    bool sleepingWaiters() {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        return m_Waiters > 0;
+    }
+
+    // one job from the own queue, else one stolen from the others; false if all were empty
+    bool runOne(unsigned int index) {
+        JobHandle job;
+        bool shared = index == workerCount();
+        Queue& own = *m_Queues[index];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                // the shared queue keeps the order the jobs came in
+                if (shared) {
+                    job = std::move(own.jobs.front());
+                    own.jobs.pop_front();
+                } else {
+                    job = std::move(own.jobs.back());
+                    own.jobs.pop_back();
+                }
+            }
+        }
+        for (size_t i = 1; !job && i < m_Queues.size(); i++) {
+            Queue& victim = *m_Queues[(index + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                if (&victim != m_Queues.back().get())
+                    own.stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (!job)
+            return false;
+        m_Queued.fetch_sub(1);
+        job->m_Work();
+        job->m_Work = nullptr;// frees what the work captured
+        own.executed.fetch_add(1, std::memory_order_relaxed);
+
+        std::vector<JobHandle> dependents;
+        {
+            std::lock_guard<std::mutex> lock(job->m_Mutex);
+            job->m_Finished.store(true, std::memory_order_release);
+            dependents.swap(job->m_Dependents);
+        }
+        for (const JobHandle& dependent : dependents)
+            release(dependent);
+        if (sleepingWaiters())
+            m_Changed.notify_all();
+        return true;
+    }
+};
+
+// the program's job system, a worker per core next to the main thread; at least one, the model loads
+// run without anyone waiting for them
+JobSystem& jobs() {
+    static JobSystem system(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return system;
+}
+
+}
+
+#endif //PROJECT_BASE_JOBSYSTEM_H
@@ -0,0 +1,110 @@
+#ifndef PROJECT_BASE_MATERIAL_H
+#define PROJECT_BASE_MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <rg/GLDebug.h>
+#include <rg/GLState.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Every kind of map always goes to the same texture unit, so sampler uniforms can be set once per
+// program instead of once per draw.
+enum TextureSlot {
+    TEXTURE_SLOT_DIFFUSE = 0,
+    TEXTURE_SLOT_SPECULAR = 1,
+    TEXTURE_SLOT_NORMAL = 2,
+    TEXTURE_SLOT_HEIGHT = 3,
+    TEXTURE_SLOT_COUNT = 4
+};
+
+const char* const TEXTURE_SLOT_SAMPLER_NAMES[TEXTURE_SLOT_COUNT] = {
+        "texture_diffuse1",
+        "texture_specular1",
+        "texture_normal1",
+        "texture_height1"
+};
+
+// Maps a loader texture type ("texture_diffuse", ...) to its slot, TEXTURE_SLOT_COUNT if unknown.
+TextureSlot textureSlotFromType(const std::string& type) {
+    if (type == "texture_diffuse")
+        return TEXTURE_SLOT_DIFFUSE;
+    if (type == "texture_specular")
+        return TEXTURE_SLOT_SPECULAR;
+    if (type == "texture_normal")
+        return TEXTURE_SLOT_NORMAL;
+    if (type == "texture_height")
+        return TEXTURE_SLOT_HEIGHT;
+    return TEXTURE_SLOT_COUNT;
+}
+
+struct Material {
+    // small sequential number, used by the render queue to group draws
+    unsigned int id = 0;
+    // GL texture per slot, 0 when the material has no such map
+    unsigned int textures[TEXTURE_SLOT_COUNT] = {0};
+    // light the surface gives off as a multiple of its diffuse map. Bloom only picks up what ends up
+    // above its threshold, which in practice is emissive surfaces only
+    float emissive = 0.0f;
+
+    // textures plus the material uniforms, which live in the shader's "material" struct; the locations
+    // come from setMaterialSamplers, so nothing is looked up or allocated here
+    void bind(GLState& state, Shader& shader) const {
+        for (unsigned int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            if (textures[slot] != 0)
+                state.bindTexture(slot, GL_TEXTURE_2D, textures[slot]);
+        }
+        glUniform1f(shader.materialEmissiveLocation, emissive);
+        glCalls().count(GL_CALL_UNIFORM);
+    }
+};
+
+// Points the sampler uniforms of a linked program at the fixed slots and looks up the location of the
+// other material uniforms for Material::bind. prefix is whatever the GLSL side nests them in, e.g.
+// "material." for a struct called material. Belongs in the program's onLinked.
+void setMaterialSamplers(Shader& shader, const std::string& prefix) {
+    shader.use();
+    for (unsigned int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+        shader.setInt(prefix + TEXTURE_SLOT_SAMPLER_NAMES[slot], slot);
+    shader.materialEmissiveLocation = glGetUniformLocation(shader.ID, (prefix + "emissive").c_str());
+    glCalls().count(GL_CALL_UNIFORM);
+}
+
+// Hands out one Material per distinct set of maps, so meshes (also of different models) that use the
+// same textures share it.
+class MaterialCache {
+public:
+    std::shared_ptr<Material> get(const unsigned int (&textures)[TEXTURE_SLOT_COUNT]) {
+        for (const std::shared_ptr<Material>& material : m_Materials) {
+            if (std::equal(textures, textures + TEXTURE_SLOT_COUNT, material->textures))
+                return material;
+        }
+        std::shared_ptr<Material> material = std::make_shared<Material>();
+        material->id = (unsigned int)m_Materials.size() + 1;
+        std::copy(textures, textures + TEXTURE_SLOT_COUNT, material->textures);
+        m_Materials.push_back(material);
+        return material;
+    }
+
+    size_t size() const {
+        return m_Materials.size();
+    }
+
+private:
+    std::vector<std::shared_ptr<Material>> m_Materials;
+};
+
+MaterialCache& materialCache() {
+    static MaterialCache cache;
+    return cache;
+}
+
+}
+
+#endif //PROJECT_BASE_MATERIAL_H
@@ -0,0 +1,82 @@
+#ifndef PROJECT_BASE_ORBITS_H
+#define PROJECT_BASE_ORBITS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+// Model matrices of the scene's bodies at a time in seconds.
+// earth model radius 1, moon model radius 1, vostok model radius ~ 1.3, sun model radius 1
+// earth radius - 6378 km = 1, 23*(M_PI/180) tilt of orbit, vostok orbit ~ 250km (6628 km) = 1.04, vostok size 0.005 km = 0.0000008, vostok orbital period = 0,06 d
+// moon orbit 384 000 km = 60, moon radius 0.27 of earth, moon orbital period = 29 d, 24*(M_PI/180) tilt of orbit (to equator of earth)
+// sun distance 149,600,000 km = 23455, sun radius 109 x earth radius
+namespace rg {
+
+glm::mat4 earthModel(float time) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, (float)(time/800), glm::vec3(0.0,1.0,0.0)); //Implementing Earth rotation around its axis
+    model = glm::rotate(model, (float)(-M_PI/2), glm::vec3(1.0,0.0,0.0)); //Fixing model wrong orientation
+    return model;
+}
+
+// the clouds grow with the camera's distance to the earth, a fix to z fighting
+glm::mat4 cloudsModel(float time, float cameraDistance) {
+    return glm::scale(earthModel(time), glm::vec3(1.002 + (cameraDistance / 400)));
+}
+
+// the point on the capsule's orbit at the given radius
+glm::mat4 vostokOrbit(float time, float radius) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, (float)(time/(800*0.06)), glm::vec3(-1.0,2.0,0.0)); //Adding rotation around the earth
+    return glm::translate(model, glm::vec3(0.0f, 0.0f, radius));
+}
+
+glm::mat4 vostokModel(float time) {
+    glm::mat4 model = vostokOrbit(time, 1.04f);//orbit made slightly bigger because it looks nicer
+    model = glm::rotate(model, (float)((time+(800*0.1*3))/(800*0.1)), glm::vec3(-1.0,2.0,-3.0)); //Adding small rotation to the model
+    return glm::scale(model, glm::vec3(1*0.00008));//Model is bigger than it should be to avoid float precision issues
+}
+
+glm::mat4 moonOrbit(float time, float radius) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, (float)((time+(800*29))/(800*29)), glm::vec3(sin((float)(24*(M_PI/180))),cos((float)(24*(M_PI/180))),0.0)); //adding rotation around the earth
+    return glm::translate(model, glm::vec3(0.0f, 0.0f, radius));
+}
+
+glm::mat4 moonModel(float time) {
+    glm::mat4 model = moonOrbit(time, 60.0f);
+    model = glm::rotate(model, (float)(time/(800*29)), glm::vec3(0.0,1.0,0.0)); //adding rotation around itself
+    model = glm::rotate(model, (float)(-M_PI/2), glm::vec3(1.0,0.0,0.0)); //Fixing model wrong orientation
+    return glm::scale(model, glm::vec3(0.27));
+}
+
+//sun size and distance not correct - due to float precision there were some glitches when put to proper values; Sun is here 10x closer and scaled to look ok
+glm::mat4 sunModel() {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2345.0f));
+    return glm::scale(model, glm::vec3(20.0));
+}
+
+// camera positions of the follow modes, just outside the capsule's and the moon's orbit
+glm::vec3 vostokFollowPosition(float time) {
+    return glm::vec3(vostokOrbit(time, 1.045f) * glm::vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+glm::vec3 moonFollowPosition(float time) {
+    return glm::vec3(moonOrbit(time, 58.0f) * glm::vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+// Points on the surfaces of the moving bodies (earth, which the clouds turn with, capsule and moon), so
+// both orbiting and spinning move them. How far they get on screen tells whether a new frame would differ.
+const unsigned int MOTION_PROBE_COUNT = 3;
+
+void motionProbes(float time, glm::vec3 probes[MOTION_PROBE_COUNT]) {
+    glm::vec4 surface(1.0, 0.0, 0.0, 1.0);
+    probes[0] = glm::vec3(earthModel(time) * surface);
+    probes[1] = glm::vec3(vostokModel(time) * surface);
+    probes[2] = glm::vec3(moonModel(time) * surface);
+}
+
+}
+
+#endif //PROJECT_BASE_ORBITS_H
@@ -0,0 +1,149 @@
+#ifndef PROJECT_BASE_PERFORMANCEHUD_H
+#define PROJECT_BASE_PERFORMANCEHUD_H
+
+#include "imgui.h"
+
+#include <rg/GLDebug.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+#include <rg/ProcessMemory.h>
+#include <rg/RenderTargetPool.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace rg {
+
+struct LoadPhase {
+    const char* name;
+    double milliseconds;
+};
+
+// Overlay with the frame time history and its lows, CPU against GPU time, the per frame counters, GPU
+// memory and the startup breakdown. Recording a frame only stores three floats; everything else, the
+// percentiles included, happens in draw(), which is only called while the HUD is shown.
+class PerformanceHud {
+public:
+    // frames kept; the 0.1% low is the average of the 2 slowest of them
+    static const unsigned int HISTORY = 2000;
+    // frames the CPU and GPU averages are taken over
+    static const unsigned int AVERAGE_FRAMES = 60;
+
+    bool visible = false;
+
+    PerformanceHud()
+        : m_FrameMs(HISTORY, 0.0f)
+        , m_CpuMs(HISTORY, 0.0f)
+        , m_GpuMs(HISTORY, 0.0f) {
+    }
+
+    // name has to stay valid (a string literal)
+    void addLoadPhase(const char* name, double milliseconds) {
+        m_LoadPhases.push_back({name, milliseconds});
+    }
+
+    // what the process holds once loading is done
+    void setStartupMemory(const ProcessMemory& memory) {
+        m_StartupMemory = memory;
+    }
+
+    // frameMs from frame start to frame start, cpuMs spent on the frame before the swap, gpuMs the GPU
+    // time of all passes (from GpuTimers, so a few frames old)
+    void record(float frameMs, float cpuMs, float gpuMs) {
+        m_FrameMs[m_Next] = frameMs;
+        m_CpuMs[m_Next] = cpuMs;
+        m_GpuMs[m_Next] = gpuMs;
+        m_Next = (m_Next + 1) % HISTORY;
+        m_Count = std::min(m_Count + 1, HISTORY);
+    }
+
+    // builds the overlay window in the current ImGui frame from the counters of the last rendered frame;
+    // inputLatencyMs 0 while not measured
+    void draw(const GLCallCounters& calls, const GLStateCounters& state, const RenderTargetPoolStats& renderTargets,
+              float inputLatencyMs) {
+        if (m_Count == 0)
+            return;
+        const ImGuiIO& io = ImGui::GetIO();
+        ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 10.0f, 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize
+                                             | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing
+                                             | ImGuiWindowFlags_NoNav);
+
+        float average = averageOf(m_FrameMs, m_Count);
+        float low1 = slowestAverage(0.01f);
+        float low01 = slowestAverage(0.001f);
+        ImGui::Text("%.2f ms (%.0f fps)", average, 1000.0f / average);
+        ImGui::Text("1%% low %.2f ms (%.0f fps), 0.1%% low %.2f ms (%.0f fps)", low1, 1000.0f / low1, low01, 1000.0f / low01);
+        // oldest first once the ring is full
+        int offset = m_Count == HISTORY ? (int)m_Next : 0;
+        ImGui::PlotLines("##frame", m_FrameMs.data(), (int)m_Count, offset, "frame ms", 0.0f,
+                         std::max(2.0f * average, low01), ImVec2(320.0f, 60.0f));
+
+        unsigned int frames = std::min(m_Count, AVERAGE_FRAMES);
+        float cpu = averageOf(m_CpuMs, frames);
+        float gpu = averageOf(m_GpuMs, frames);
+        ImGui::Text("CPU %.2f ms, GPU %.2f ms - %s bound", cpu, gpu, gpu > cpu ? "GPU" : "CPU");
+        float scale = std::max(cpu, gpu) * 2.0f;
+        ImGui::PlotLines("##cpu", m_CpuMs.data(), (int)m_Count, offset, "CPU ms", 0.0f, scale, ImVec2(320.0f, 30.0f));
+        ImGui::PlotLines("##gpu", m_GpuMs.data(), (int)m_Count, offset, "GPU ms", 0.0f, scale, ImVec2(320.0f, 30.0f));
+        if (inputLatencyMs > 0.0f)
+            ImGui::Text("Input to present %.1f ms", inputLatencyMs);
+
+        ImGui::Separator();
+        ImGui::Text("Draw calls %u, triangles %u", calls.calls[GL_CALL_DRAW], calls.triangles);
+        ImGui::Text("Program binds %u, texture binds %u", state.programBinds, state.textureBinds);
+
+        ImGui::Separator();
+        const GpuMemory& memory = gpuMemory();
+        ImGui::Text("VRAM %.1f MB: textures %.1f, buffers %.1f, render targets %.1f",
+                    (memory.textureBytes + memory.bufferBytes + renderTargets.allocatedBytes) / 1e6,
+                    memory.textureBytes / 1e6, memory.bufferBytes / 1e6, renderTargets.allocatedBytes / 1e6);
+
+        ImGui::Separator();
+        double loadTotal = 0.0;
+        for (const LoadPhase& phase : m_LoadPhases) {
+            ImGui::Text("%-14s %8.1f ms", phase.name, phase.milliseconds);
+            loadTotal += phase.milliseconds;
+        }
+        ImGui::Text("%-14s %8.1f ms", "startup", loadTotal);
+        if (m_StartupMemory.peakResidentBytes > 0)
+            ImGui::Text("RAM after loading %.1f MB, peak %.1f MB", m_StartupMemory.residentBytes / 1e6,
+                        m_StartupMemory.peakResidentBytes / 1e6);
+        ImGui::End();
+    }
+
+private:
+    std::vector<float> m_FrameMs;
+    std::vector<float> m_CpuMs;
+    std::vector<float> m_GpuMs;
+    std::vector<float> m_Sorted;
+    std::vector<LoadPhase> m_LoadPhases;
+    ProcessMemory m_StartupMemory;
+    unsigned int m_Next = 0;
+    unsigned int m_Count = 0;
+
+    // of the newest frames
+    float averageOf(const std::vector<float>& samples, unsigned int frames) const {
+        float sum = 0.0f;
+        for (unsigned int i = 1; i <= frames; i++)
+            sum += samples[(m_Next + HISTORY - i) % HISTORY];
+        return sum / frames;
+    }
+
+    // average frame time of the slowest share of the history
+    float slowestAverage(float share) {
+        unsigned int count = std::max(1u, (unsigned int)(m_Count * share));
+        m_Sorted.assign(m_FrameMs.begin(), m_FrameMs.begin() + m_Count);
+        std::partial_sort(m_Sorted.begin(), m_Sorted.begin() + count, m_Sorted.end(), std::greater<float>());
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < count; i++)
+            sum += m_Sorted[i];
+        return sum / count;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_PERFORMANCEHUD_H
@@ -0,0 +1,44 @@
+#ifndef PROJECT_BASE_PROCESSMEMORY_H
+#define PROJECT_BASE_PROCESSMEMORY_H
+
+#include <cstdint>
+#include <cstdio>
+#ifdef __APPLE__
+#include <sys/resource.h>
+#endif
+
+namespace rg {
+
+// CPU memory of the process as the OS sees it: what is resident now and the most that ever was (the
+// high-water mark loading leaves behind). 0 where the platform does not tell.
+struct ProcessMemory {
+    uint64_t residentBytes = 0;
+    uint64_t peakResidentBytes = 0;
+};
+
+ProcessMemory processMemory() {
+    ProcessMemory memory;
+#ifdef __linux__
+    // VmRSS and VmHWM, in kB
+    if (FILE* status = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        unsigned long long kilobytes;
+        while (std::fgets(line, sizeof(line), status)) {
+            if (std::sscanf(line, "VmRSS: %llu", &kilobytes) == 1)
+                memory.residentBytes = kilobytes * 1024;
+            else if (std::sscanf(line, "VmHWM: %llu", &kilobytes) == 1)
+                memory.peakResidentBytes = kilobytes * 1024;
+        }
+        std::fclose(status);
+    }
+#elif defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        memory.peakResidentBytes = (uint64_t)usage.ru_maxrss;// in bytes there
+#endif
+    return memory;
+}
+
+}
+
+#endif //PROJECT_BASE_PROCESSMEMORY_H
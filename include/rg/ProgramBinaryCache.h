@@ -0,0 +1,144 @@
+#ifndef PROJECT_BASE_PROGRAMBINARYCACHE_H
+#define PROJECT_BASE_PROGRAMBINARYCACHE_H
+
+#include <glad/glad.h>
+#include <rg/GLExtensions.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace rg {
+
+struct ProgramBinaryCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    // binaries found on disk that the driver refused (driver update, different GPU, ...)
+    unsigned int rejected = 0;
+};
+
+// Keeps linked programs on disk with glGetProgramBinary and loads them back with glProgramBinary. The
+// key hashes the final sources, the defines and the GL vendor/renderer/version strings, so a changed
+// shader or driver never picks up a stale binary. Does nothing until a directory is set or when the
+// context has no program binary support.
+class ProgramBinaryCache {
+public:
+    ProgramBinaryCacheStats stats;
+
+    void setDirectory(const std::string& directory) {
+        m_Directory = directory;
+        if (!m_Directory.empty())
+            mkdir(m_Directory.c_str(), 0755);
+    }
+
+    bool enabled() const {
+        return !m_Directory.empty() && glExtensions().programBinary;
+    }
+
+    uint64_t key(const std::vector<std::string>& sources, const std::vector<std::string>& defines) {
+        uint64_t hash = FNV_OFFSET;
+        for (const std::string& source : sources)
+            hash = fnv1a(hash, source);
+        for (const std::string& define : defines)
+            hash = fnv1a(hash, define);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char* value = (const char*)glGetString(name);
+            hash = fnv1a(hash, value != nullptr ? value : "");
+        }
+        return hash;
+    }
+
+    // true if program is linked from the cached binary; counts a miss otherwise
+    bool load(uint64_t key, unsigned int program) {
+        std::ifstream in(path(key), std::ios::binary);
+        uint32_t header[3] = {0};
+        if (!in || !in.read((char*)header, sizeof(header)) || header[0] != MAGIC) {
+            stats.misses++;
+            return false;
+        }
+        std::vector<char> binary(header[2]);
+        if (!in.read(binary.data(), binary.size())) {
+            stats.misses++;
+            return false;
+        }
+
+        glExtensions().ProgramBinary(program, header[1], binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            stats.rejected++;
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        return true;
+    }
+
+    // has to be called before linking a program that should be stored afterwards
+    void prepare(unsigned int program) {
+        glExtensions().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    void store(uint64_t key, unsigned int program) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glExtensions().GetProgramBinary(program, length, &length, &format, binary.data());
+
+        std::ofstream out(path(key), std::ios::binary | std::ios::trunc);
+        uint32_t header[3] = {MAGIC, format, (uint32_t)length};
+        out.write((const char*)header, sizeof(header));
+        out.write(binary.data(), length);
+        if (!out)
+            std::cout << "WARNING::SHADER::BINARY_CACHE_WRITE_FAILED " << path(key) << std::endl;
+    }
+
+    void report() const {
+        if (!enabled()) {
+            std::cout << "Program binary cache: disabled" << std::endl;
+            return;
+        }
+        std::cout << "Program binary cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+                  << stats.rejected << " rejected by the driver)" << std::endl;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x42504752; // "RGPB"
+    static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    static const uint64_t FNV_PRIME = 1099511628211ull;
+
+    std::string m_Directory;
+
+    static uint64_t fnv1a(uint64_t hash, const std::string& data) {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= FNV_PRIME;
+        }
+        // separator, so that ("ab", "c") and ("a", "bc") hash differently
+        hash ^= 0xFF;
+        hash *= FNV_PRIME;
+        return hash;
+    }
+
+    std::string path(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return m_Directory + "/" + name;
+    }
+};
+
+ProgramBinaryCache& programBinaryCache() {
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+}
+
+#endif //PROJECT_BASE_PROGRAMBINARYCACHE_H
@@ -0,0 +1,278 @@
+#ifndef PROJECT_BASE_RENDERQUEUE_H
+#define PROJECT_BASE_RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/model.h>
+#include <rg/GLDebug.h>
+#include <rg/GLState.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+enum RenderPass {
+    RENDER_PASS_OPAQUE = 0,
+    RENDER_PASS_BLENDED = 1
+};
+
+// Debug views where every draw adds a weight to the red channel of the target instead of shading; the
+// shaders have to be built with HEATMAP (write the "heatmapWeight" uniform)
+enum HeatmapMode {
+    HEATMAP_OFF = 0,
+    HEATMAP_OVERDRAW = 1,   // 1 per fragment that passes the depth test
+    HEATMAP_SHADER_COST = 2 // setShaderCost of the program plus a fetch per map of the material
+};
+
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// LSD radix sort on 8 bit digits. Digits that are the same for every key (very common, e.g. the pass
+// bits) are skipped without moving anything. Result ends up in entries, scratch is reused storage.
+void radixSortEntries(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    const size_t count = entries.size();
+    if (count < 2)
+        return;
+    scratch.resize(count);
+
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+    for (unsigned int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {0};
+        for (size_t i = 0; i < count; i++)
+            histogram[(src[i].key >> shift) & 0xFF]++;
+
+        if (histogram[(src[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (unsigned int digit = 0; digit < 256; digit++) {
+            size_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; i++)
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != entries.data())
+        std::memcpy(entries.data(), src, count * sizeof(SortEntry));
+}
+
+struct RenderQueueStats {
+    unsigned int submitted = 0;
+    unsigned int drawCalls = 0;
+    // part of drawCalls that went to the depth pre-pass
+    unsigned int prepassDrawCalls = 0;
+    unsigned int skippedStateChanges = 0;
+};
+
+// Collects the draws of one frame, sorts them by a 64 bit key and submits them through the GL state
+// cache, so consecutive items that share state cost no state changes.
+//
+// Key layout, most significant bits first:
+//   opaque:  pass(2) | program(10) | material(16) | vao(12) | depth(24)
+//   blended: pass(2) | ~depth(24)  | program(10)  | material(16) | vao(12)
+// Opaque items are grouped by state and drawn front to back inside a group. Blended items have to be
+// drawn back to front to compose correctly, so there the depth takes precedence over the state.
+class RenderQueue {
+public:
+    RenderQueueStats stats;
+    // sets "previousModel" for every draw to the model matrix the mesh had in the last frame, for
+    // motion vectors. A mesh drawn more than once per frame gets the matrix of its last draw.
+    bool motionVectors = false;
+    // blends every draw additively and sets its weight, depth testing stays as in normal drawing
+    HeatmapMode heatmap = HEATMAP_OFF;
+
+    // starts a new frame; depth keys are measured from cameraPosition
+    void begin(const glm::vec3& cameraPosition) {
+        m_CameraPosition = cameraPosition;
+        m_Items.clear();
+        m_Entries.clear();
+        m_ShaderCosts.clear();
+        stats = RenderQueueStats();
+    }
+
+    // rough cost of a fragment of the shader in texture fetches, for HEATMAP_SHADER_COST; 1 if not set.
+    // Like the submits only valid for the frame.
+    void setShaderCost(const Shader& shader, float cost) {
+        m_ShaderCosts.push_back({&shader, cost});
+    }
+
+    void submit(RenderPass pass, Shader& shader, Model& model, const glm::mat4& modelMatrix) {
+        for (Mesh& mesh : model.meshes)
+            submit(pass, shader, mesh, modelMatrix);
+    }
+
+    void submit(RenderPass pass, Shader& shader, Mesh& mesh, const glm::mat4& modelMatrix) {
+        DrawItem item;
+        item.shader = &shader;
+        item.mesh = &mesh;
+        item.model = modelMatrix;
+        item.pass = pass;
+
+        SortEntry entry;
+        entry.key = makeKey(pass, shader.ID, mesh.material->id, mesh.VAO, viewDepth(mesh, modelMatrix));
+        entry.index = (uint32_t)m_Items.size();
+
+        m_Items.push_back(item);
+        m_Entries.push_back(entry);
+        stats.submitted++;
+    }
+
+    // sorts and draws everything submitted since begin(). With a depthPrepass shader (model, view and
+    // projection like the color shaders, positions at location 0) the opaque items first lay down depth
+    // through their position-only stream, and their color pass then shades only the visible fragment
+    // with GL_EQUAL. Blended items have to blend over what is behind them, so they are not pre-passed.
+    void flush(Shader* depthPrepass = nullptr) {
+        radixSortEntries(m_Entries, m_Scratch);
+
+        GLState& state = glState();
+        unsigned int skippedBefore = state.currentFrame().skipped;
+        if (depthPrepass != nullptr)
+            drawDepthPrepass(state, *depthPrepass);
+
+        const DrawItem* previous = nullptr;
+        for (const SortEntry& entry : m_Entries) {
+            const DrawItem& item = m_Items[entry.index];
+
+            if (item.pass == RENDER_PASS_BLENDED) {
+                state.enable(GL_BLEND);
+                state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                state.depthFunc(GL_LESS);
+                state.depthMask(true);
+            } else {
+                state.disable(GL_BLEND);
+                state.depthFunc(depthPrepass != nullptr ? GL_EQUAL : GL_LESS);
+                state.depthMask(depthPrepass == nullptr);//the pre-pass wrote the very same values already
+            }
+            if (heatmap != HEATMAP_OFF) {
+                state.enable(GL_BLEND);
+                state.blendFunc(GL_ONE, GL_ONE);
+            }
+
+            state.useProgram(item.shader->ID);
+            item.shader->setMat4("model", item.model);
+            if (heatmap != HEATMAP_OFF)
+                item.shader->setFloat("heatmapWeight", heatmapWeight(item));
+            if (motionVectors) {
+                auto previousModel = m_PreviousModels.find(item.mesh);
+                item.shader->setMat4("previousModel", previousModel != m_PreviousModels.end() ? previousModel->second : item.model);
+                m_CurrentModels[item.mesh] = item.model;
+            }
+
+            // material uniforms belong to the program, so a program change needs them again too
+            if (previous == nullptr || previous->mesh->material != item.mesh->material || previous->shader != item.shader)
+                item.mesh->material->bind(state, *item.shader);
+
+            state.bindVertexArray(item.mesh->VAO);
+            glDrawElements(GL_TRIANGLES, item.mesh->indexCount, GL_UNSIGNED_INT, 0);
+            glCalls().countDraw(item.mesh->indexCount / 3);
+            stats.drawCalls++;
+            previous = &item;
+        }
+        state.depthFunc(GL_LESS);
+        state.depthMask(true);
+        stats.skippedStateChanges = state.currentFrame().skipped - skippedBefore;
+        // meshes that were not drawn this frame start without history next time
+        m_PreviousModels.swap(m_CurrentModels);
+        m_CurrentModels.clear();
+    }
+
+private:
+    struct DrawItem {
+        Shader* shader;
+        Mesh* mesh;
+        glm::mat4 model;
+        RenderPass pass;
+    };
+
+    std::vector<DrawItem> m_Items;
+    std::vector<SortEntry> m_Entries;
+    std::vector<SortEntry> m_Scratch;
+    std::unordered_map<const Mesh*, glm::mat4> m_PreviousModels;
+    std::unordered_map<const Mesh*, glm::mat4> m_CurrentModels;
+    std::vector<std::pair<const Shader*, float>> m_ShaderCosts;
+    glm::vec3 m_CameraPosition = glm::vec3(0.0f);
+
+    float heatmapWeight(const DrawItem& item) const {
+        if (heatmap == HEATMAP_OVERDRAW)
+            return 1.0f;
+        float cost = 1.0f;
+        for (const std::pair<const Shader*, float>& shaderCost : m_ShaderCosts) {
+            if (shaderCost.first == item.shader)
+                cost = shaderCost.second;
+        }
+        for (unsigned int texture : item.mesh->material->textures)
+            cost += texture != 0;
+        return cost;
+    }
+
+    void drawDepthPrepass(GLState& state, Shader& shader) {
+        pushGLDebugGroup("depth pre-pass");
+        state.disable(GL_BLEND);
+        state.depthFunc(GL_LESS);
+        state.depthMask(true);
+        state.colorMask(false);
+        state.useProgram(shader.ID);
+        // opaque items come first and front to back inside every state group
+        for (const SortEntry& entry : m_Entries) {
+            const DrawItem& item = m_Items[entry.index];
+            if (item.pass != RENDER_PASS_OPAQUE)
+                break;
+            shader.setMat4("model", item.model);
+            state.bindVertexArray(item.mesh->depthVAO);
+            glDrawElements(GL_TRIANGLES, item.mesh->indexCount, GL_UNSIGNED_INT, 0);
+            glCalls().countDraw(item.mesh->indexCount / 3);
+            stats.drawCalls++;
+            stats.prepassDrawCalls++;
+        }
+        state.colorMask(true);
+        popGLDebugGroup();
+    }
+
+    // distance from the camera to the front of the mesh's bounding sphere
+    float viewDepth(const Mesh& mesh, const glm::mat4& modelMatrix) const {
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                               std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        return std::max(glm::distance(m_CameraPosition, center) - mesh.boundingRadius * scale, 0.0f);
+    }
+
+    // non negative floats keep their order when compared as integers, the top 24 bits are plenty
+    static uint64_t quantizeDepth(float depth) {
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 8;
+    }
+
+    static uint64_t makeKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vao, float depth) {
+        uint64_t depthBits = quantizeDepth(depth);
+        uint64_t key = (uint64_t)(pass & 0x3) << 62;
+        if (pass == RENDER_PASS_BLENDED) {
+            key |= (~depthBits & 0xFFFFFF) << 38;
+            key |= (uint64_t)(program & 0x3FF) << 28;
+            key |= (uint64_t)(material & 0xFFFF) << 12;
+            key |= (uint64_t)(vao & 0xFFF);
+        } else {
+            key |= (uint64_t)(program & 0x3FF) << 52;
+            key |= (uint64_t)(material & 0xFFFF) << 36;
+            key |= (uint64_t)(vao & 0xFFF) << 24;
+            key |= depthBits & 0xFFFFFF;
+        }
+        return key;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_RENDERQUEUE_H
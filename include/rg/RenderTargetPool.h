@@ -0,0 +1,164 @@
+#ifndef PROJECT_BASE_RENDERTARGETPOOL_H
+#define PROJECT_BASE_RENDERTARGETPOOL_H
+
+#include <glad/glad.h>
+#include <rg/GLState.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+// Bytes per pixel of the formats used for render targets, for the memory statistics
+unsigned int renderTargetBytesPerPixel(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RGBA16F:
+        case GL_RGBA16:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        default: // RGBA8, R11F_G11F_B10F, depth 24/32 (24 bit depth is padded by every driver)
+            return 4;
+    }
+}
+
+struct RenderTargetPoolStats {
+    unsigned int targets = 0;
+    unsigned int inUse = 0;
+    uint64_t allocatedBytes = 0;
+    unsigned int allocations = 0; // since startup
+};
+
+// Hands out color textures and depth renderbuffers by (format, size). Released targets stay allocated
+// for a few frames, so a target that is asked for again with the same description (a format toggled
+// back, another pass with the same needs) comes back without touching the driver's allocator. Targets
+// that stay unused are deleted in endFrame.
+class RenderTargetPool {
+public:
+    // frames a released target is kept around before its memory is given back
+    static const unsigned int MAX_IDLE_FRAMES = 3;
+
+    // linear filtering, clamped to the edge so blur filters do not pick up the opposite border
+    unsigned int acquireTexture(GLenum internalFormat, GLenum format, int width, int height) {
+        Target* target = find(false, internalFormat, width, height);
+        if (target != nullptr)
+            return target->id;
+
+        Target created{0, false, internalFormat, width, height, true, 0};
+        glGenTextures(1, &created.id);
+        glState().bindTexture(GL_TEXTURE_2D, created.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return add(created);
+    }
+
+    unsigned int acquireDepth(int width, int height) {
+        Target* target = find(true, GL_DEPTH_COMPONENT24, width, height);
+        if (target != nullptr)
+            return target->id;
+
+        Target created{0, true, GL_DEPTH_COMPONENT24, width, height, true, 0};
+        glGenRenderbuffers(1, &created.id);
+        glBindRenderbuffer(GL_RENDERBUFFER, created.id);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        return add(created);
+    }
+
+    // textures and renderbuffers have separate names, hence the two functions
+    void releaseTexture(unsigned int id) {
+        release(false, id);
+    }
+
+    void releaseDepth(unsigned int id) {
+        release(true, id);
+    }
+
+    // call once per frame; deletes targets that were not used for MAX_IDLE_FRAMES frames
+    void endFrame() {
+        for (size_t i = 0; i < m_Targets.size(); ) {
+            Target& target = m_Targets[i];
+            if (target.inUse || ++target.idleFrames <= MAX_IDLE_FRAMES) {
+                i++;
+                continue;
+            }
+            destroy(target);
+            m_Targets[i] = m_Targets.back();
+            m_Targets.pop_back();
+        }
+    }
+
+    RenderTargetPoolStats stats() const {
+        RenderTargetPoolStats result;
+        result.allocations = m_Allocations;
+        for (const Target& target : m_Targets) {
+            result.targets++;
+            result.inUse += target.inUse;
+            result.allocatedBytes += (uint64_t)target.width * target.height * renderTargetBytesPerPixel(target.internalFormat);
+        }
+        return result;
+    }
+
+private:
+    struct Target {
+        unsigned int id;
+        bool renderbuffer;
+        GLenum internalFormat;
+        int width;
+        int height;
+        bool inUse;
+        unsigned int idleFrames;
+    };
+
+    std::vector<Target> m_Targets;
+    unsigned int m_Allocations = 0;
+
+    Target* find(bool renderbuffer, GLenum internalFormat, int width, int height) {
+        for (Target& target : m_Targets) {
+            if (!target.inUse && target.renderbuffer == renderbuffer && target.internalFormat == internalFormat
+                && target.width == width && target.height == height) {
+                target.inUse = true;
+                target.idleFrames = 0;
+                return &target;
+            }
+        }
+        return nullptr;
+    }
+
+    unsigned int add(const Target& target) {
+        m_Targets.push_back(target);
+        m_Allocations++;
+        return target.id;
+    }
+
+    void release(bool renderbuffer, unsigned int id) {
+        for (Target& target : m_Targets) {
+            if (target.renderbuffer == renderbuffer && target.id == id) {
+                target.inUse = false;
+                target.idleFrames = 0;
+                return;
+            }
+        }
+    }
+
+    static void destroy(const Target& target) {
+        if (target.renderbuffer) {
+            glDeleteRenderbuffers(1, &target.id);
+        } else {
+            glState().forgetTexture(target.id);
+            glDeleteTextures(1, &target.id);
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_RENDERTARGETPOOL_H
@@ -0,0 +1,56 @@
+#ifndef PROJECT_BASE_SCRATCHARENA_H
+#define PROJECT_BASE_SCRATCHARENA_H
+
+#include <cstddef>
+#include <memory>
+
+namespace rg {
+
+// One allocation carved up by a bump pointer, for data that lives and dies together (an asset's vertex
+// data between decoding and upload). Sized up front: the pointers handed out stay valid until the arena is
+// destroyed, moving it included. Only for trivially copyable types, nothing is constructed or destroyed.
+class ScratchArena {
+public:
+    explicit ScratchArena(size_t capacity)
+        : m_Memory(new unsigned char[capacity])
+        , m_Capacity(capacity) {
+    }
+
+    // count uninitialized Ts; nullptr once the capacity is used up
+    template<typename T>
+    T* allocate(size_t count) {
+        size_t offset = alignedOffset(alignof(T));
+        if (offset + count * sizeof(T) > m_Capacity)
+            return nullptr;
+        m_Used = offset + count * sizeof(T);
+        return reinterpret_cast<T*>(m_Memory.get() + offset);
+    }
+
+    // what allocating count Ts after the ones already accounted for (bytes) takes, padding included
+    template<typename T>
+    static size_t bytesFor(size_t bytes, size_t count) {
+        return (bytes + alignof(T) - 1) / alignof(T) * alignof(T) + count * sizeof(T);
+    }
+
+    size_t capacity() const {
+        return m_Capacity;
+    }
+
+    size_t used() const {
+        return m_Used;
+    }
+
+private:
+    std::unique_ptr<unsigned char[]> m_Memory;
+    size_t m_Capacity;
+    size_t m_Used = 0;
+
+    // new[] aligns for every fundamental type, so aligning the offset aligns the address
+    size_t alignedOffset(size_t alignment) const {
+        return (m_Used + alignment - 1) / alignment * alignment;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SCRATCHARENA_H
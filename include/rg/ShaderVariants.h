@@ -0,0 +1,85 @@
+#ifndef PROJECT_BASE_SHADERVARIANTS_H
+#define PROJECT_BASE_SHADERVARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// One shader source compiled into a program per combination of feature flags. Flag i of the key turns
+// into "#define flagNames[i]", variants are built the first time they are asked for and kept.
+// Shader references handed out stay valid for the lifetime of the object.
+class ShaderVariants {
+public:
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> flagNames,
+                   std::function<void(Shader&)> onLinked = nullptr)
+        : m_VertexPath(std::move(vertexPath))
+        , m_FragmentPath(std::move(fragmentPath))
+        , m_FlagNames(std::move(flagNames))
+        , m_OnLinked(std::move(onLinked)) {
+    }
+
+    // a variant that is being reloaded is returned with its old program until the new one links
+    Shader& get(unsigned int key) {
+        auto it = m_Variants.find(key);
+        Shader& shader = it != m_Variants.end() ? it->second : start(key);
+        if (shader.ID == 0)
+            shader.wait();
+        return shader;
+    }
+
+    // flags in the order of flagNames, e.g. get({enableBloom, enableHDR})
+    Shader& get(std::initializer_list<bool> flags) {
+        return get(makeKey(flags));
+    }
+
+    static unsigned int makeKey(std::initializer_list<bool> flags) {
+        unsigned int key = 0;
+        unsigned int bit = 0;
+        for (bool flag : flags)
+            key |= (unsigned int)flag << bit++;
+        return key;
+    }
+
+    // hands every combination to the driver up front, so toggling never compiles in the middle of a
+    // frame; the builds finish on get() or when the caller waits/polls them
+    void startAll() {
+        for (unsigned int key = 0; key < (1u << m_FlagNames.size()); key++) {
+            if (m_Variants.find(key) == m_Variants.end())
+                start(key);
+        }
+    }
+
+    template<typename Function>
+    void forEach(Function function) {
+        for (auto& variant : m_Variants)
+            function(variant.second);
+    }
+
+private:
+    std::string m_VertexPath;
+    std::string m_FragmentPath;
+    std::vector<std::string> m_FlagNames;
+    std::function<void(Shader&)> m_OnLinked;
+    std::map<unsigned int, Shader> m_Variants;
+
+    Shader& start(unsigned int key) {
+        std::vector<std::string> defines;
+        for (unsigned int i = 0; i < m_FlagNames.size(); i++) {
+            if (key & (1u << i))
+                defines.push_back(m_FlagNames[i]);
+        }
+        Shader& shader = m_Variants.emplace(key, Shader::deferred(m_VertexPath.c_str(), m_FragmentPath.c_str(), defines)).first->second;
+        shader.onLinked = m_OnLinked;
+        return shader;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SHADERVARIANTS_H
@@ -0,0 +1,115 @@
+#ifndef PROJECT_BASE_SHADERWATCHER_H
+#define PROJECT_BASE_SHADERWATCHER_H
+
+#include <learnopengl/shader.h>
+#include <rg/ShaderVariants.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace rg {
+
+// Watches the shader directory with inotify and rebuilds every program that was built from a changed
+// file, includes too. Builds run in the background when the driver has KHR_parallel_shader_compile;
+// a program keeps drawing with its old version until the new one has linked, a broken edit keeps the
+// old version for good. On other systems only the startup helpers do anything.
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(const std::string& directory)
+        : m_Directory(directory) {
+#ifdef __linux__
+        m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        // editors either rewrite the file or write a new one and move it over the old
+        if (m_Fd >= 0 && inotify_add_watch(m_Fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(m_Fd);
+            m_Fd = -1;
+        }
+        if (m_Fd < 0)
+            std::cout << "WARNING::SHADER::WATCH_FAILED " << directory << ", hot reload disabled" << std::endl;
+#endif
+    }
+
+    ~ShaderWatcher() {
+#ifdef __linux__
+        if (m_Fd >= 0)
+            close(m_Fd);
+#endif
+    }
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    void add(Shader& shader) {
+        m_Shaders.push_back(&shader);
+    }
+
+    // only variants that exist at this point are watched, so call ShaderVariants::startAll first
+    void add(ShaderVariants& variants) {
+        variants.forEach([this](Shader& shader) { add(shader); });
+    }
+
+    // finishes every build that is still pending, used once at startup after all builds were started
+    void waitAll() {
+        for (Shader* shader : m_Shaders)
+            shader->wait();
+    }
+
+    // call once per frame; never waits for the driver when it can compile in parallel. True while a
+    // rebuild is in flight or when one just finished, so the image may change.
+    bool update() {
+        for (const std::string& file : changedFiles()) {
+            for (Shader* shader : m_Shaders) {
+                if (std::find(shader->files.begin(), shader->files.end(), file) != shader->files.end())
+                    shader->reload();
+            }
+        }
+        bool busy = false;
+        for (Shader* shader : m_Shaders) {
+            if (!shader->pending())
+                continue;
+            busy = true;
+            bool linked = shader->poll();
+            if (!shader->pending())
+                std::cout << (linked ? "Reloaded " : "Reload failed, keeping the old program: ") << shader->files.front() << std::endl;
+        }
+        return busy;
+    }
+
+private:
+    std::string m_Directory;
+    std::vector<Shader*> m_Shaders;
+    int m_Fd = -1;
+
+    std::vector<std::string> changedFiles() {
+        std::vector<std::string> files;
+#ifdef __linux__
+        if (m_Fd < 0)
+            return files;
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(m_Fd, buffer, sizeof(buffer))) > 0) {
+            for (char* event = buffer; event < buffer + length; ) {
+                const inotify_event* info = (const inotify_event*)event;
+                if (info->len > 0) {
+                    std::string file = m_Directory + "/" + info->name;
+                    if (std::find(files.begin(), files.end(), file) == files.end())
+                        files.push_back(file);
+                }
+                event += sizeof(inotify_event) + info->len;
+            }
+        }
+#endif
+        return files;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_SHADERWATCHER_H
@@ -0,0 +1,62 @@
+#ifndef PROJECT_BASE_STAGINGBUFFER_H
+#define PROJECT_BASE_STAGINGBUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace rg {
+
+// Pixel unpack buffer for texture uploads. The pixels are copied into memory the driver hands out, and
+// glTexImage2D then only records a transfer from the buffer instead of copying from client memory before
+// it returns. The storage is orphaned on every use: the driver gives the next upload fresh memory while
+// transfers still queued read the old one, so nothing waits on the GPU.
+// Belongs to one context, release() it there.
+class StagingBuffer {
+public:
+    // leaves a copy of data bound to GL_PIXEL_UNPACK_BUFFER, pixel pointers of texture calls are then offsets
+    // into it (0); false if the buffer could not be mapped, nothing is bound then
+    bool stage(const void* data, size_t bytes) {
+        if (m_Buffer == 0)
+            glGenBuffers(1, &m_Buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        // the unmap fails if the storage was lost meanwhile (mode switch), the contents are undefined then
+        bool staged = mapped != nullptr;
+        if (staged) {
+            std::memcpy(mapped, data, bytes);
+            staged = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        }
+        if (!staged) {
+            unbind();
+            return false;
+        }
+        m_StagedBytes += bytes;
+        return true;
+    }
+
+    // after the texture calls that read the staged pixels
+    void unbind() {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void release() {
+        glDeleteBuffers(1, &m_Buffer);
+        m_Buffer = 0;
+    }
+
+    uint64_t stagedBytes() const {
+        return m_StagedBytes;
+    }
+
+private:
+    unsigned int m_Buffer = 0;
+    uint64_t m_StagedBytes = 0;
+};
+
+}
+
+#endif //PROJECT_BASE_STAGINGBUFFER_H
@@ -0,0 +1,38 @@
+#ifndef PROJECT_BASE_TEMPORALUPSCALING_H
+#define PROJECT_BASE_TEMPORALUPSCALING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace rg {
+
+// Frames in one jitter cycle; after that every scene pixel was sampled at 8 well spread positions
+const unsigned int TEMPORAL_JITTER_SAMPLES = 8;
+
+// radical inverse of index in the given base, the Halton sequence
+float halton(unsigned int index, unsigned int base) {
+    float result = 0.0f;
+    float fraction = 1.0f / base;
+    for (; index > 0; index /= base) {
+        result += fraction * (index % base);
+        fraction /= base;
+    }
+    return result;
+}
+
+// Subpixel offset of the scene for a frame, in pixels within [-0.5, 0.5]. Halton(2, 3) starting at 1,
+// because index 0 would be (0, 0) in both bases.
+glm::vec2 temporalJitter(unsigned int frameIndex) {
+    unsigned int index = frameIndex % TEMPORAL_JITTER_SAMPLES + 1;
+    return glm::vec2(halton(index, 2) - 0.5f, halton(index, 3) - 0.5f);
+}
+
+// Shifts everything drawn with the projection by jitter pixels of a width x height target
+glm::mat4 jitterProjection(const glm::mat4& projection, const glm::vec2& jitter, unsigned int width, unsigned int height) {
+    glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * jitter.x / width, 2.0f * jitter.y / height, 0.0f));
+    return offset * projection;
+}
+
+}
+
+#endif //PROJECT_BASE_TEMPORALUPSCALING_H
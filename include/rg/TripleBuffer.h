@@ -0,0 +1,53 @@
+#ifndef PROJECT_BASE_TRIPLEBUFFER_H
+#define PROJECT_BASE_TRIPLEBUFFER_H
+
+#include <atomic>
+
+namespace rg {
+
+// Hands the newest value from one producer thread to one consumer thread without locks. Of the three
+// slots the producer fills one and the consumer reads one; the third holds the last published value.
+// publish() and take() swap their slot with that one in a single atomic exchange, a flag next to the
+// shared index tells whether it was published since the last take. Neither side waits or copies, and a
+// value published while the consumer was busy replaces the unread one.
+// The slot handed to the producer after publish() holds an older value, so it has to be written in full.
+template<typename T>
+class TripleBuffer {
+public:
+    // the slot the producer fills before publish()
+    T& writeBuffer() {
+        return m_Slots[m_Write];
+    }
+
+    void publish() {
+        unsigned int previous = m_Shared.exchange(m_Write | FRESH, std::memory_order_acq_rel);
+        m_Write = previous & INDEX;
+    }
+
+    // moves the newest published value to readBuffer(); false when nothing was published since
+    bool take() {
+        if (!(m_Shared.load(std::memory_order_acquire) & FRESH))
+            return false;
+        unsigned int previous = m_Shared.exchange(m_Read, std::memory_order_acq_rel);
+        m_Read = previous & INDEX;
+        return true;
+    }
+
+    // the consumer's slot, valid until the next take()
+    T& readBuffer() {
+        return m_Slots[m_Read];
+    }
+
+private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;
+
+    T m_Slots[3];
+    std::atomic<unsigned int> m_Shared{1};
+    unsigned int m_Write = 0;
+    unsigned int m_Read = 2;
+};
+
+}
+
+#endif //PROJECT_BASE_TRIPLEBUFFER_H
@@ -0,0 +1,154 @@
+#ifndef PROJECT_BASE_UPLOADSERVICE_H
+#define PROJECT_BASE_UPLOADSERVICE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <rg/GLState.h>
+#include <rg/JobSystem.h>
+#include <rg/StagingBuffer.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace rg {
+
+// Uploads on a second context that shares its objects with the one drawing, so creating textures and
+// buffers never stalls a frame. A hidden window provides the context, a loader thread keeps it current
+// and runs the submitted work in order. Each upload ends with a fence, flushed so the GPU sees it; its
+// completion runs in poll() on the drawing thread only once the fence signaled, which is when the objects
+// are complete and safe to bind there. Objects that hold state per context (vertex arrays, framebuffers)
+// cannot be shared and belong in the completion.
+// Without a second context (start() failed or was not called) poll() runs the work itself, in the middle
+// of a frame of the drawing context; the state cache is invalidated after it, the work binds past it.
+class UploadService {
+public:
+    // on the main thread, which GLFW creates windows on; share is the drawing window
+    bool start(GLFWwindow* share) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        m_Window = glfwCreateWindow(1, 1, "loader", NULL, share);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (m_Window == NULL)
+            return false;
+        m_Thread = std::thread([this]() { loaderLoop(); });
+        return true;
+    }
+
+    // on the main thread; work not started yet and completions not polled yet are dropped
+    void stop() {
+        if (m_Window == NULL) {
+            m_Staging.release();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_all();
+        m_Thread.join();
+        // sync objects are shared, any context can delete them
+        for (Completion& completion : m_Completions)
+            glDeleteSync(completion.fence);
+        m_Completions.clear();
+        glfwDestroyWindow(m_Window);
+        m_Window = NULL;
+    }
+
+    // from any thread: work gets the loader context and its staging buffer, done runs in poll() afterwards
+    void submit(std::function<void(StagingBuffer&)> work, std::function<void()> done) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Uploads.push_back({std::move(work), std::move(done)});
+        }
+        m_Wake.notify_one();
+    }
+
+    // on the drawing thread, once per frame; never waits for the GPU. Returns the completions it ran.
+    unsigned int poll() {
+        if (m_Window == NULL)
+            runInline();
+        unsigned int completed = 0;
+        while (true) {
+            Completion completion;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (m_Completions.empty())
+                    break;
+                GLenum result = glClientWaitSync(m_Completions.front().fence, 0, 0);
+                if (result == GL_TIMEOUT_EXPIRED)
+                    break;// later uploads were fenced after it
+                completion = std::move(m_Completions.front());
+                m_Completions.pop_front();
+            }
+            glDeleteSync(completion.fence);
+            completion.done();
+            completed++;
+        }
+        return completed;
+    }
+
+private:
+    struct Upload {
+        std::function<void(StagingBuffer&)> work;
+        std::function<void()> done;
+    };
+    struct Completion {
+        GLsync fence = nullptr;
+        std::function<void()> done;
+    };
+
+    GLFWwindow* m_Window = NULL;
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<Upload> m_Uploads;
+    std::deque<Completion> m_Completions;
+    StagingBuffer m_Staging;// of the loader context, or of the drawing one when running inline
+    bool m_Stop = false;
+
+    void loaderLoop() {
+        setThreadName("rg-loader");
+        glfwMakeContextCurrent(m_Window);
+        while (true) {
+            Upload upload;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this]() { return m_Stop || !m_Uploads.empty(); });
+                if (m_Stop)
+                    break;
+                upload = std::move(m_Uploads.front());
+                m_Uploads.pop_front();
+            }
+            upload.work(m_Staging);
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            // a fence that never reaches the GPU never signals, the drawing context does not flush this one
+            glFlush();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Completions.push_back({fence, std::move(upload.done)});
+        }
+        m_Staging.release();
+        glfwMakeContextCurrent(NULL);
+    }
+
+    void runInline() {
+        while (true) {
+            Upload upload;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (m_Uploads.empty())
+                    break;
+                upload = std::move(m_Uploads.front());
+                m_Uploads.pop_front();
+            }
+            upload.work(m_Staging);
+            glState().invalidate();
+            upload.done();
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_UPLOADSERVICE_H
@@ -0,0 +1,27 @@
+#version 330 core
+#include "common.glsl"
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform float threshold;
+uniform float knee;
+
+void main()
+{
+    //Renders into a half resolution target; four bilinear taps between the source texels average a 4x4 block,
+    //so nothing bright falls through the gaps of the downsample
+    vec2 texel = 1.0 / textureSize(scene, 0);
+    vec3 color = 0.25 * (texture(scene, TexCoords + texel * vec2(-1.0, -1.0)).rgb
+                       + texture(scene, TexCoords + texel * vec2( 1.0, -1.0)).rgb
+                       + texture(scene, TexCoords + texel * vec2(-1.0,  1.0)).rgb
+                       + texture(scene, TexCoords + texel * vec2( 1.0,  1.0)).rgb);
+
+    //Soft knee: the contribution ramps in quadratically from threshold - knee instead of popping in at the threshold
+    float brightness = luminance(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    FragColor = vec4(color * contribution, 1.0);
+}
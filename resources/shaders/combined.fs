@@ -1,26 +1,35 @@
 #version 330 core
+// BLOOM - add the blurred bright parts
+// HDR - exposure tone mapping
+// AUTO_EXPOSURE - exposure from the luminance histogram, the uniform only compensates it
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
-uniform bool bloom;
-uniform bool HDR;
 uniform float exposure;
+#ifdef AUTO_EXPOSURE
+uniform sampler2D autoExposure;//1x1, written by the compute passes of rg::AutoExposure
+#endif
 
 void main()//code just copied from learnopengl but really no changes are necessary
 {
     const float gamma = 2.2;
     vec3 hdrColor = texture(scene, TexCoords).rgb;
+#ifdef BLOOM
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
-    if(bloom)
-        hdrColor += bloomColor; // additive blending
+    hdrColor += bloomColor; // additive blending
+#endif
     // tone mapping
     vec3 result = hdrColor;
-    if (HDR){
-        result = vec3(1.0) - exp(-result * exposure);
-    }
+#ifdef HDR
+    float finalExposure = exposure;
+#ifdef AUTO_EXPOSURE
+    finalExposure *= texelFetch(autoExposure, ivec2(0), 0).r;
+#endif
+    result = vec3(1.0) - exp(-result * finalExposure);
+#endif
     // gamma correction
     result = pow(result, vec3(1.0 / gamma));
     FragColor = vec4(result, 1.0);
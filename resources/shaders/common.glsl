@@ -0,0 +1,12 @@
+// shared helpers, pulled in with #include "common.glsl" (resolved by Shader, not by the GLSL compiler)
+
+float luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// screen space motion from the previous frame to this one, in texture coordinates
+vec2 motionVector(vec4 currentClip, vec4 previousClip)
+{
+    return (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
@@ -1,6 +1,17 @@
 #version 330 core
+// ENABLE_FONG - plain Phong specular instead of Blinn-Phong
+// MOTION_VECTORS - second output with the screen space motion, for temporal upscaling
+// HEATMAP - write heatmapWeight instead of the color, for the overdraw and shader cost views
+#include "common.glsl"
 layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+#ifdef MOTION_VECTORS
+layout (location = 1) out vec4 Motion;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+#endif
+#ifdef HEATMAP
+uniform float heatmapWeight;//added up with additive blending
+#endif
 
 struct PointLight {
     vec3 position;
@@ -19,6 +30,7 @@ struct Material {
     sampler2D texture_specular1;
 
     float shininess;
+    float emissive;//light the surface gives off, as a multiple of the diffuse map
 };
 in vec2 TexCoords;
 in vec3 Normal;
@@ -29,8 +41,6 @@ uniform Material material;
 
 uniform vec3 viewPosition;
 
-uniform bool enable_fong = false;
-
 // calculates the color when using a point light.
 vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -39,17 +49,16 @@ vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
 
     float spec = 0.0;
-    if (enable_fong){
-        vec3 reflectDir = reflect(-lightDir, normal);
-        spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    }
-    else{
-        if (dot(lightDir, normal) > 0.0){
+#ifdef ENABLE_FONG
+    vec3 reflectDir = reflect(-lightDir, normal);
+    spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+#else
+    if (dot(lightDir, normal) > 0.0){
 
-            vec3 halfwayDir = normalize(lightDir + viewDir);
-            spec = pow(max(dot(normal, halfwayDir), 0.0), 3*material.shininess);
-        }
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        spec = pow(max(dot(normal, halfwayDir), 0.0), 3*material.shininess);
     }
+#endif
 
     // attenuation
     float distance = length(light.position - fragPos);
@@ -70,10 +79,12 @@ void main()
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
     vec4 result = CalcPointLight(pointLight, normal, FragPos, viewDir);
+    result.rgb += material.emissive * texture(material.texture_diffuse1, TexCoords).rgb;
     FragColor = result;
-    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    if(brightness > 1.0)
-      BrightColor = FragColor;
-    else
-      BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+#ifdef HEATMAP
+    FragColor = vec4(heatmapWeight, 0.0, 0.0, 1.0);
+#endif
+#ifdef MOTION_VECTORS
+    Motion = vec4(motionVector(CurrentClip, PreviousClip), 0.0, result.a);//alpha so that blending treats it like the color
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#version 330 core
+// FXAA on the tone mapped image, following the quality path of Timothy Lottes' FXAA 3.11: find the
+// direction of a contrast edge, walk along it to both ends and blend across it by how far the pixel is
+// from the nearer end. The presets only change the uniforms.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform float edgeThreshold;//contrast relative to the local maximum that counts as an edge
+uniform float edgeThresholdMin;//absolute minimum contrast, keeps dark areas untouched
+uniform float subpixel;//how much single pixel features are smoothed
+uniform int searchSteps;//texture reads along the edge in each direction
+
+//Luma of the gamma corrected color, which is what FXAA is tuned for
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+float lumaAt(vec2 uv)
+{
+    return luma(texture(image, uv).rgb);
+}
+
+void main()
+{
+    vec2 texel = 1.0 / textureSize(image, 0);
+    vec3 colorCenter = texture(image, TexCoords).rgb;
+    float lumaCenter = luma(colorCenter);
+    float lumaDown = luma(textureOffset(image, TexCoords, ivec2(0, -1)).rgb);
+    float lumaUp = luma(textureOffset(image, TexCoords, ivec2(0, 1)).rgb);
+    float lumaLeft = luma(textureOffset(image, TexCoords, ivec2(-1, 0)).rgb);
+    float lumaRight = luma(textureOffset(image, TexCoords, ivec2(1, 0)).rgb);
+
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+    if (lumaRange < max(edgeThresholdMin, lumaMax * edgeThreshold))
+    {
+        FragColor = vec4(colorCenter, 1.0);
+        return;
+    }
+
+    float lumaDownLeft = luma(textureOffset(image, TexCoords, ivec2(-1, -1)).rgb);
+    float lumaUpRight = luma(textureOffset(image, TexCoords, ivec2(1, 1)).rgb);
+    float lumaUpLeft = luma(textureOffset(image, TexCoords, ivec2(-1, 1)).rgb);
+    float lumaDownRight = luma(textureOffset(image, TexCoords, ivec2(1, -1)).rgb);
+
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    //Is the edge horizontal or vertical
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + 2.0 * abs(-2.0 * lumaCenter + lumaDownUp) + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + 2.0 * abs(-2.0 * lumaCenter + lumaLeftRight) + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    //On which side of the pixel the edge runs
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+    float stepLength = isHorizontal ? texel.y : texel.x;
+    float lumaLocalAverage;
+    if (is1Steepest)
+    {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else
+    {
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+    }
+    vec2 edgeUV = TexCoords;
+    if (isHorizontal)
+        edgeUV.y += 0.5 * stepLength;
+    else
+        edgeUV.x += 0.5 * stepLength;
+
+    //Walk along the edge in both directions until the contrast changes, in growing steps
+    vec2 offset = isHorizontal ? vec2(texel.x, 0.0) : vec2(0.0, texel.y);
+    vec2 uv1 = edgeUV - offset;
+    vec2 uv2 = edgeUV + offset;
+    float lumaEnd1 = lumaAt(uv1) - lumaLocalAverage;
+    float lumaEnd2 = lumaAt(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+    for (int i = 1; i < searchSteps && !(reached1 && reached2); i++)
+    {
+        float stepSize = i < 5 ? 1.0 : (i < 6 ? 1.5 : (i < 10 ? 2.0 : 4.0));
+        if (!reached1)
+        {
+            uv1 -= offset * stepSize;
+            lumaEnd1 = lumaAt(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2)
+        {
+            uv2 += offset * stepSize;
+            lumaEnd2 = lumaAt(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = isHorizontal ? TexCoords.x - uv1.x : TexCoords.y - uv1.y;
+    float distance2 = isHorizontal ? uv2.x - TexCoords.x : uv2.y - TexCoords.y;
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float pixelOffset = 0.5 - distanceFinal / (distance1 + distance2);
+    //Only blend when the nearer end really is where this side of the edge stops
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    //Subpixel aliasing: contrast of the pixel against the average of its 3x3 neighbourhood
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixelOffset = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    subPixelOffset = (-2.0 * subPixelOffset + 3.0) * subPixelOffset * subPixelOffset;
+    finalOffset = max(finalOffset, subPixelOffset * subPixelOffset * subpixel);
+
+    vec2 finalUV = TexCoords;
+    if (isHorizontal)
+        finalUV.y += finalOffset * stepLength;
+    else
+        finalUV.x += finalOffset * stepLength;
+    FragColor = vec4(texture(image, finalUV).rgb, 1.0);
+}
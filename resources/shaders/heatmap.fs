@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D weights;//red channel, added up by the HEATMAP variants of the scene shaders
+uniform float maxWeight;//shown white, as is everything above
+
+// black - blue - green - yellow - red - white
+vec3 heat(float t)
+{
+    const vec3 stops[6] = vec3[6](vec3(0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0),
+                                  vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0));
+    float position = clamp(t, 0.0, 1.0) * 5.0;
+    int stop = min(int(position), 4);
+    return mix(stops[stop], stops[stop + 1], position - float(stop));
+}
+
+void main()
+{
+    float weight = texture(weights, TexCoords).r;
+    //nothing drawn stays black, a single layer already shows as blue
+    FragColor = vec4(weight > 0.0 ? heat(max(weight / maxWeight, 0.2)) : vec3(0.0), 1.0);
+}
@@ -1,6 +1,16 @@
 #version 330 core
+// MOTION_VECTORS - second output with the screen space motion, for temporal upscaling
+// HEATMAP - write heatmapWeight instead of the color, for the overdraw and shader cost views
+#include "common.glsl"
 layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+#ifdef MOTION_VECTORS
+layout (location = 1) out vec4 Motion;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+#endif
+#ifdef HEATMAP
+uniform float heatmapWeight;//added up with additive blending
+#endif
 
 in vec3 TexCoords;
 
@@ -9,7 +19,11 @@ uniform samplerCube skybox;
 void main()
 {
     FragColor = 0.25*texture(skybox, TexCoords).xxxw;//Taking just the red component looks much nicer, couldnt find better skybox online
-
-    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    BrightColor = vec4(0.0, 0.0, 0.0, 1.0);//No need to add bloom to the stars since the immage already has it
+    //It stays well below the bloom threshold, no need to add bloom to the stars since the immage already has it
+#ifdef HEATMAP
+    FragColor = vec4(heatmapWeight, 0.0, 0.0, 1.0);
+#endif
+#ifdef MOTION_VECTORS
+    Motion = vec4(motionVector(CurrentClip, PreviousClip), 0.0, 1.0);
+#endif
 }
\ No newline at end of file
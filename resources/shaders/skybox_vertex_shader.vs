@@ -6,9 +6,20 @@ out vec3 TexCoords;
 uniform mat4 projection;
 uniform mat4 view;
 
+#ifdef MOTION_VECTORS
+uniform mat4 currentViewProjection;//rotation only like view, without the jitter that projection has
+uniform mat4 previousViewProjection;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+#endif
+
 void main()
 {
     TexCoords = aPos;
     vec4 pos = projection * view * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
+#ifdef MOTION_VECTORS
+    CurrentClip = currentViewProjection * vec4(aPos, 1.0);
+    PreviousClip = previousViewProjection * vec4(aPos, 1.0);
+#endif
 }
\ No newline at end of file
@@ -1,20 +1,37 @@
 #version 330 core
+// MOTION_VECTORS - second output with the screen space motion, for temporal upscaling
+// HEATMAP - write heatmapWeight instead of the color, for the overdraw and shader cost views
+#include "common.glsl"
 layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+#ifdef MOTION_VECTORS
+layout (location = 1) out vec4 Motion;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+#endif
+#ifdef HEATMAP
+uniform float heatmapWeight;//added up with additive blending
+#endif
+
+struct Material {
+    sampler2D texture_diffuse1;
+
+    float emissive;
+};
 
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform sampler2D texture_diffuse1;
+uniform Material material;
 
 void main()
 {
     //simple shader that just returns the ambient value of lighting; used to render the sun
-    FragColor = 50*vec4(vec3(texture(texture_diffuse1, TexCoords)), 1.0);
-    float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    if(brightness > 1.0)
-      BrightColor = FragColor;
-    else
-      BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+    FragColor = vec4(material.emissive * vec3(texture(material.texture_diffuse1, TexCoords)), 1.0);
+#ifdef HEATMAP
+    FragColor = vec4(heatmapWeight, 0.0, 0.0, 1.0);
+#endif
+#ifdef MOTION_VECTORS
+    Motion = vec4(motionVector(CurrentClip, PreviousClip), 0.0, 1.0);
+#endif
 }
\ No newline at end of file
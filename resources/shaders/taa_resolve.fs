@@ -0,0 +1,48 @@
+#version 330 core
+#include "common.glsl"
+// Temporal upscaling: blends the jittered scene (possibly rendered at a lower resolution) into the
+// reprojected history of the previous frames, at the output resolution
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D current;
+uniform sampler2D motion;
+uniform sampler2D history;
+uniform vec2 jitter;//this frame's jitter, in texture coordinates
+uniform bool historyValid;
+uniform float feedback;//weight of the new frame
+
+void main()
+{
+    //The scene was shifted by the jitter, so the unjittered point lies jitter further along
+    vec2 uv = TexCoords + jitter;
+    vec2 texel = 1.0 / textureSize(current, 0);
+    vec3 color = texture(current, uv).rgb;
+
+    //History that falls outside the colors around the pixel belongs to something that moved away or got uncovered
+    vec3 low = color;
+    vec3 high = color;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec3 neighbour = texture(current, uv + vec2(x, y) * texel).rgb;
+            low = min(low, neighbour);
+            high = max(high, neighbour);
+        }
+    }
+
+    vec2 previousUV = TexCoords - texture(motion, uv).xy;
+    if (!historyValid || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0))))
+    {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+    vec3 previous = clamp(texture(history, previousUV).rgb, low, high);
+
+    //Weighting by inverse luminance keeps single very bright samples (the sun) from flickering through the blend
+    float currentWeight = feedback / (1.0 + luminance(color));
+    float previousWeight = (1.0 - feedback) / (1.0 + luminance(previous));
+    FragColor = vec4((color * currentWeight + previous * previousWeight) / (currentWeight + previousWeight), 1.0);
+}
@@ -11,10 +11,25 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+//Must match depth_prepass.vs bit for bit, the color pass tests GL_EQUAL against it
+invariant gl_Position;
+
+#ifdef MOTION_VECTORS
+uniform mat4 previousModel;
+uniform mat4 currentViewProjection;//both without the jitter that projection has
+uniform mat4 previousViewProjection;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+#endif
+
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = vec3(transpose(inverse(model)) * vec4(aNormal, 1.0));
     TexCoords = aTexCoords;    
     gl_Position = projection * view * vec4(FragPos, 1.0);
+#ifdef MOTION_VECTORS
+    CurrentClip = currentViewProjection * vec4(FragPos, 1.0);
+    PreviousClip = previousViewProjection * previousModel * vec4(aPos, 1.0);
+#endif
 }
\ No newline at end of file
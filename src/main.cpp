@@ -14,8 +14,39 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <rg/AutoExposure.h>
+#include <rg/AutoTuner.h>
+#include <rg/Bandwidth.h>
+#include <rg/FramePacer.h>
+#include <rg/GLDebug.h>
+#include <rg/GLExtensions.h>
+#include <rg/GLState.h>
+#include <rg/GoldenImage.h>
+#include <rg/GpuMemory.h>
+#include <rg/GpuTimers.h>
+#include <rg/JobSystem.h>
+#include <rg/Orbits.h>
+#include <rg/PerformanceHud.h>
+#include <rg/ProcessMemory.h>
+#include <rg/ProgramBinaryCache.h>
+#include <rg/RenderTargetPool.h>
+#include <rg/RenderQueue.h>
+#include <rg/ShaderVariants.h>
+#include <rg/ShaderWatcher.h>
+#include <rg/TemporalUpscaling.h>
+#include <rg/TripleBuffer.h>
+#include <rg/UploadService.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
 
 #include "cmath"
 
@@ -29,10 +60,28 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+
+bool movementKeysHeld(GLFWwindow *window);
+
+float screenMotion(const glm::mat4& viewProjection, float fromTime, float toTime);
+
 unsigned int loadCubemap(vector<std::string> faces);
 
 void renderQuad();
 
+struct ProgramState;
+
+void allocateHdrTargets(const ProgramState& settings, unsigned int width, unsigned int height);
+
+void applyGoldenCase();
+
+bool captureGoldenFrame(unsigned int width, unsigned int height);
+
+void startAutoTuning();
+
+void applyQualityPreset(int preset);
+
 
 // settings
 unsigned int SCR_WIDTH = 1200;
@@ -48,10 +97,156 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-//Textures for framebuffers and depth buffer (global so they can be resized when window is resized)
+//On-demand rendering: the loop sleeps in glfwWaitEventsTimeout until input arrives (set by the callbacks),
+//a shader is rebuilt or the bodies moved further on screen than the threshold. Every trigger renders a few
+//frames, which lets the temporal history converge and ImGui catch up with the input.
+std::atomic<bool> redrawRequested(true);//also set by the render side when a model streamed in
+const unsigned int ON_DEMAND_SETTLE_FRAMES = 16;
+const double ON_DEMAND_WAIT_SECONDS = 0.1;//how often the motion of the bodies is checked while idle
+
+//Frames in flight, the frame limiter and the input latency measurement
+rg::FramePacer framePacer;
+//Renders on the main thread instead of a render thread of its own (--single-thread)
+bool singleThread = false;
+
+//Framebuffers and their targets (global so they can be resized when window is resized)
+unsigned int hdrFBO;
+unsigned int pingpongFBO[2];
 unsigned int pingpongColorbuffers[2];
 unsigned int rboDepth;
-unsigned int colorBuffers[2];
+unsigned int colorBuffer;
+int allocatedHdrFormat = -1;
+rg::RenderTargetPool renderTargets;
+
+//Temporal upscaling: the scene renders into colorBuffer/motionBuffer at sceneWidth x sceneHeight, the
+//resolve pass accumulates it into one of the full size history buffers
+unsigned int taaFBO[2];
+unsigned int historyBuffers[2] = {0, 0};
+unsigned int motionBuffer = 0;
+unsigned int historyIndex = 0;//history buffer written this frame, the other one holds the last frame
+bool historyValid = false;
+bool allocatedTemporal = false;
+float allocatedRenderScale = 1.0f;
+unsigned int sceneWidth = 0;
+unsigned int sceneHeight = 0;
+
+//The bloom chain runs at half resolution
+unsigned int bloomWidth = 0;
+unsigned int bloomHeight = 0;
+//Size of the render targets. It lags behind the window while it is being resized, the final pass
+//stretches the image to the window in the meantime
+unsigned int renderWidth = 0;
+unsigned int renderHeight = 0;
+//Frames since the last resize event, the targets are reallocated once the size stayed put for a few
+unsigned int framesSinceResize = 0;
+const unsigned int RESIZE_SETTLE_FRAMES = 8;
+
+//Tone mapped image for FXAA, which works on the final LDR colors
+unsigned int ldrFBO;
+unsigned int ldrBuffer = 0;
+bool allocatedFxaa = false;
+
+//FXAA quality presets, close to the FXAA 3.11 quality levels 12, 23 and 39
+struct FxaaPreset {
+    const char* name;
+    float edgeThreshold;
+    float edgeThresholdMin;
+    float subpixel;
+    int searchSteps;
+};
+const FxaaPreset FXAA_PRESETS[] = {
+        {"Low", 0.250f, 0.0833f, 0.50f, 4},
+        {"Medium", 0.166f, 0.0833f, 0.75f, 8},
+        {"High", 0.125f, 0.0625f, 0.75f, 12}
+};
+const int FXAA_PRESET_COUNT = sizeof(FXAA_PRESETS) / sizeof(FXAA_PRESETS[0]);
+
+//Rough fragment cost of the scene shaders for the shader cost heatmap, in texture fetches; the render
+//queue adds one per map of the material
+const float LIT_SHADER_COST = 8.0f;
+const float SUN_SHADER_COST = 1.0f;
+const float SKYBOX_SHADER_COST = 2.0f;//the cubemap fetch included
+const char* const HEATMAP_NAMES[] = {"Off", "Overdraw", "Shader cost"};
+
+//Estimated render target traffic of the last frame, shown in the ImGui window
+rg::BandwidthEstimate frameBandwidth;
+//GPU time per pass, shown in the ImGui window
+rg::GpuTimers gpuTimers;
+//Frame times, counters and memory, toggled with F2 apart from the settings window
+rg::PerformanceHud performanceHud;
+
+//Golden image check, run with --golden (--golden-update rewrites the references first): every performance
+//mode renders the same viewpoints at a pinned simulation time in a hidden window and is compared with the
+//references taken from the baseline path. The exit code is 1 if any case is outside its tolerance, and
+//GOLDEN_SKIPPED if none is but references are missing (the test runner counts the check as skipped then).
+const float GOLDEN_TIME = 1000.0f;
+const unsigned int GOLDEN_WIDTH = 480;
+const unsigned int GOLDEN_HEIGHT = 360;
+const unsigned int GOLDEN_SETTLE_FRAMES = 24;//rendered per case before the capture, the temporal history converges
+const char* const GOLDEN_DIRECTORY = "resources/golden";
+const int GOLDEN_SKIPPED = 77;//SKIP_RETURN_CODE of the golden test in CMakeLists.txt
+struct GoldenViewpoint {
+    const char* name;
+    glm::vec3 position;
+    glm::vec3 target;
+};
+struct GoldenMode {
+    const char* name;
+    int hdrFormat;
+    bool temporalUpscaling;
+    bool fxaa;
+    bool depthPrepass;
+    float deltaETolerance;//a pixel fails above it, 2.3 is about the smallest visible difference
+    float maxFailingShare;//of the pixels
+};
+//The first mode is the baseline. The tolerances allow for what a mode changes on purpose: FXAA and the
+//upscaler move edges, the smaller format bands the gradients slightly.
+const GoldenMode GOLDEN_MODES[] = {
+        {"baseline", 1, false, false, false, 2.3f, 0.001f},
+        {"r11g11b10", 0, false, false, false, 2.3f, 0.01f},
+        {"depth_prepass", 1, false, false, true, 2.3f, 0.001f},
+        {"fxaa", 1, false, true, false, 2.3f, 0.05f},
+        {"temporal", 1, true, false, false, 10.0f, 0.05f}
+};
+const unsigned int GOLDEN_MODE_COUNT = sizeof(GOLDEN_MODES) / sizeof(GOLDEN_MODES[0]);
+struct GoldenRun {
+    bool enabled = false;
+    bool update = false;
+    unsigned int viewpoint = 0;
+    unsigned int mode = 0;
+    unsigned int frame = 0;
+    unsigned int failures = 0;
+    unsigned int missing = 0;//cases without a reference to compare with
+};
+GoldenRun golden;
+
+std::vector<GoldenViewpoint> goldenViewpoints();
+
+Camera viewpointCamera(const GoldenViewpoint& viewpoint);
+
+//Quality presets of the auto-tuner, highest quality first. Anti-aliasing is FXAA at one of its presets,
+//or the temporal resolve of the upscaler on the low end.
+struct QualityPreset {
+    const char* name;
+    int bloomPasses;
+    bool temporalUpscaling;
+    float renderScale;
+    int hdrFormat;
+    float lodBias;
+    bool fxaa;
+    int fxaaQuality;
+};
+const QualityPreset QUALITY_PRESETS[] = {
+        {"Ultra", 8, false, 1.0f, 1, 0.0f, true, 2},
+        {"High", 6, false, 1.0f, 1, 0.0f, true, 1},
+        {"Medium", 6, false, 1.0f, 0, 0.0f, true, 0},
+        {"Low", 4, true, 0.67f, 0, 0.5f, false, 0},
+        {"Lowest", 2, true, 0.5f, 0, 1.0f, false, 0}
+};
+const int QUALITY_PRESET_COUNT = sizeof(QUALITY_PRESETS) / sizeof(QUALITY_PRESETS[0]);
+//Runs on the first start and whenever the GPU or driver changed, flying through the golden image viewpoints
+rg::AutoTuner autoTuner;
+Camera cameraBeforeTuning;
 
 
 struct PointLight {
@@ -75,6 +270,29 @@ struct ProgramState {
     bool enable_bloom = true;
     bool enable_HDR = true;
     float exposure = 1.0;
+    float bloomThreshold = 1.0;//luminance where bloom starts, reached in practice only by emissive materials
+    float bloomKnee = 0.5;//bloom fades in over [threshold - knee, threshold + knee]
+    bool autoExposure = true;//needs compute shaders, exposure then only compensates the measured brightness
+    float adaptationSpeed = 1.5;
+    bool temporalUpscaling = false;
+    float renderScale = 0.67;//share of the output resolution the scene renders at with temporal upscaling
+    bool depthPrepass = false;//toggle and compare the scene pass timing, the gain depends on the viewpoint
+    bool fxaa = true;
+    int fxaaQuality = 1;//index into FXAA_PRESETS
+    int hdrFormat = 0;//index into rg::HDR_FORMATS, used for the scene and bloom targets
+    bool lowLatency = false;//caps the frames in flight and takes the input as late as possible
+    int maxFramesInFlight = 1;
+    float frameLimit = 0.0;//frames per second for displays without vsync, 0 for none
+    bool onDemand = false;//render only when something changed, for unattended displays
+    float redrawThreshold = 0.5;//pixels the bodies may move on screen before on-demand rendering redraws
+    int bloomPasses = 6;//blur passes at half resolution, 6 spread about as far as 20 at full resolution
+    float lodBias = 0.0;//of the model textures
+    int qualityPreset = -1;//index into QUALITY_PRESETS the settings came from, -1 before the first tuning
+    float targetFrameMs = 16.7;//the auto-tuner picks the best preset that stays below it
+    std::string tunedFor;//rg::deviceFingerprint() of the last tuning
+    int heatmap = rg::HEATMAP_OFF;//debug view in place of the shaded image
+    float heatmapScale = 8.0;//weight shown white
+    bool pipelineStatistics = false;
     PointLight pointLight;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
@@ -87,34 +305,150 @@ struct ProgramState {
 void ProgramState::SaveToFile(std::string filename) {
     std::ofstream out(filename);
     out << ImGuiEnabled << '\n';
+    out << tunedFor << '\n';
+    out << qualityPreset << ' ' << bloomPasses << ' ' << temporalUpscaling << ' ' << renderScale << ' ' << hdrFormat << ' '
+        << lodBias << ' ' << fxaa << ' ' << fxaaQuality << ' ' << targetFrameMs << '\n';
+    out << onDemand << ' ' << redrawThreshold << '\n';
+    out << lowLatency << ' ' << maxFramesInFlight << ' ' << frameLimit << '\n';
 }
 
 void ProgramState::LoadFromFile(std::string filename) {
     std::ifstream in(filename);
     if (in) {
         in >> ImGuiEnabled;
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::getline(in, tunedFor);
+        in >> qualityPreset >> bloomPasses >> temporalUpscaling >> renderScale >> hdrFormat >> lodBias >> fxaa >> fxaaQuality
+           >> targetFrameMs;
+        //a file from before the tuner (or a damaged one) is tuned again, which overwrites whatever was read
+        if (!in || hdrFormat < 0 || hdrFormat >= rg::HDR_FORMAT_COUNT || fxaaQuality < 0 || fxaaQuality >= FXAA_PRESET_COUNT
+            || qualityPreset >= QUALITY_PRESET_COUNT)
+            tunedFor.clear();
+        bool savedOnDemand;
+        float savedRedrawThreshold;
+        if (in >> savedOnDemand >> savedRedrawThreshold) {
+            onDemand = savedOnDemand;
+            redrawThreshold = savedRedrawThreshold;
+        }
+        bool savedLowLatency;
+        int savedMaxFramesInFlight;
+        float savedFrameLimit;
+        if (in >> savedLowLatency >> savedMaxFramesInFlight >> savedFrameLimit) {
+            lowLatency = savedLowLatency;
+            maxFramesInFlight = std::max(savedMaxFramesInFlight, 1);
+            frameLimit = savedFrameLimit;
+        }
     }
 }
 
 ProgramState *programState;
 
-void DrawImGui(ProgramState *programState);
+//The ImGui frame built on the update side; its draw lists are copied, ImGui reuses its own for the next frame
+struct UiSnapshot {
+    bool valid = false;
+    ImDrawData drawData;
+    std::vector<ImDrawList*> lists;
+
+    UiSnapshot() = default;
+    UiSnapshot(const UiSnapshot&) = delete;
+    UiSnapshot& operator=(const UiSnapshot&) = delete;
+    ~UiSnapshot() {
+        clear();
+    }
+
+    void capture(const ImDrawData* source) {
+        clear();
+        if (source == nullptr || !source->Valid)
+            return;
+        for (int i = 0; i < source->CmdListsCount; i++)
+            lists.push_back(source->CmdLists[i]->CloneOutput());
+        drawData = *source;
+        drawData.CmdLists = lists.data();
+        valid = true;
+    }
+
+    void clear() {
+        for (ImDrawList* list : lists)
+            IM_DELETE(list);
+        lists.clear();
+        valid = false;
+    }
+};
+
+//Everything the render side needs of a frame. The update side fills it and hands it over, the render side
+//only reads it: settings, camera and light in state, the body transforms and the UI.
+struct FrameSnapshot {
+    ProgramState state;
+    float simulationTime = 0.0f;
+    float deltaTime = 0.0f;
+    float updateMs = 0.0f;//CPU time the update side spent on the frame
+    double inputTime = -1.0;//from framePacer.latchInput()
+    unsigned int windowWidth = 0;
+    unsigned int windowHeight = 0;
+    unsigned int targetWidth = 0;//size for the render targets, lags behind the window while it is resized
+    unsigned int targetHeight = 0;
+    glm::mat4 projection;//unjittered
+    glm::mat4 view;
+    glm::mat4 earth, clouds, vostok, moon, sun;
+    bool drawClouds = false;
+    UiSnapshot ui;
+};
+
+//The render side's counters of its last frame, handed back for the UI, the HUD and the auto-tuner
+struct RenderStats {
+    std::vector<rg::PassTiming> passTimings;
+    bool pipelineStatistics = false;
+    float gpuMs = 0.0f;
+    float cpuMs = 0.0f;
+    rg::BandwidthEstimate bandwidth;
+    rg::GLStateCounters glStateCalls;
+    rg::GLCallCounters glCalls;
+    rg::RenderTargetPoolStats renderTargets;
+    unsigned int renderWidth = 0;
+    unsigned int renderHeight = 0;
+    float inputLatencyMs = 0.0f;
+    unsigned int framesInFlight = 0;
+};
+
+void DrawImGui(ProgramState *programState, const RenderStats& stats);
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--golden" || argument == "--golden-update") {
+            golden.enabled = true;
+            golden.update = argument == "--golden-update";
+        }
+        if (argument == "--single-thread")
+            singleThread = true;
+    }
+    if (golden.enabled) {
+        SCR_WIDTH = GOLDEN_WIDTH;
+        SCR_HEIGHT = GOLDEN_HEIGHT;
+    }
 
-int main() {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    //4.3 for compute shaders (auto exposure), everything else runs on 3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, RG_GL_DEBUG ? GL_TRUE : GL_FALSE);//drivers report more in a debug context
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (golden.enabled)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // glfw window creation
     // --------------------
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if (window == NULL) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -123,9 +457,15 @@ int main() {
 
 
     glfwMakeContextCurrent(window);
+    if (golden.enabled) {
+        glfwSwapInterval(0);
+        mkdir(GOLDEN_DIRECTORY, 0755);
+    }
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);//ImGui chains its own callbacks to these
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { redrawRequested = true; });//uncovered, on-demand rendering redraws
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -135,11 +475,8 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
-
-
-    glGenTextures(2, pingpongColorbuffers);//initializing textures and depth buffer for framebuffer before glfwSetFramebufferSizeCallback so that they exist if the func is called
-    glGenRenderbuffers(1, &rboDepth);
-    glGenTextures(2, colorBuffers);
+    rg::loadGLExtensions((GLADloadproc) glfwGetProcAddress);
+    rg::enableGLDebugOutput();
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
@@ -164,83 +501,137 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE); //Enable face culling, in this way the side of the models not facing us is not rendered
+    rg::glState().enable(GL_DEPTH_TEST);
+    rg::glState().enable(GL_CULL_FACE); //Enable face culling, in this way the side of the models not facing us is not rendered
 
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("resources/shaders/vertex_shader.vs", "resources/shaders/fragment_shader.fs");
-    Shader sunShader("resources/shaders/vertex_shader.vs", "resources/shaders/sun_fragment_shader.fs");
-    Shader skyboxShader("resources/shaders/skybox_vertex_shader.vs", "resources/shaders/skybox_fragment_shader.fs");
-    Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.fs");
-    Shader finalShader("resources/shaders/combined.vs", "resources/shaders/combined.fs");
+    rg::programBinaryCache().setDirectory("resources/shader_cache");
+    double shaderBuildStart = glfwGetTime();
+    //Feature toggles are compiled in as #defines, every combination is its own program picked at draw time
+    rg::ShaderVariants litShaders("resources/shaders/vertex_shader.vs", "resources/shaders/fragment_shader.fs",
+                                  {"ENABLE_FONG", "MOTION_VECTORS", "HEATMAP"},
+                                  [](Shader& shader) { rg::setMaterialSamplers(shader, "material."); });
+    //Every program is only handed to the driver here and waited for at the end, so they can all compile at once
+    rg::ShaderVariants sunShaders("resources/shaders/vertex_shader.vs", "resources/shaders/sun_fragment_shader.fs",
+                                  {"MOTION_VECTORS", "HEATMAP"},
+                                  [](Shader& shader) { rg::setMaterialSamplers(shader, "material."); });
+    rg::ShaderVariants skyboxShaders("resources/shaders/skybox_vertex_shader.vs", "resources/shaders/skybox_fragment_shader.fs",
+                                     {"MOTION_VECTORS", "HEATMAP"});
+    Shader bloomPrefilterShader = Shader::deferred("resources/shaders/blur.vs", "resources/shaders/bloom_prefilter.fs");
+    bloomPrefilterShader.onLinked = [](Shader& shader) {
+        shader.use();
+        shader.setInt("scene", 0);
+    };
+    Shader depthPrepassShader = Shader::deferred("resources/shaders/depth_prepass.vs", "resources/shaders/depth_prepass.fs");
+    Shader taaShader = Shader::deferred("resources/shaders/blur.vs", "resources/shaders/taa_resolve.fs");
+    taaShader.onLinked = [](Shader& shader) {
+        shader.use();
+        shader.setInt("current", 0);
+        shader.setInt("motion", 1);
+        shader.setInt("history", 2);
+    };
+    Shader fxaaShader = Shader::deferred("resources/shaders/blur.vs", "resources/shaders/fxaa.fs");
+    fxaaShader.onLinked = [](Shader& shader) {
+        shader.use();
+        shader.setInt("image", 0);
+    };
+    Shader heatmapShader = Shader::deferred("resources/shaders/blur.vs", "resources/shaders/heatmap.fs");
+    heatmapShader.onLinked = [](Shader& shader) {
+        shader.use();
+        shader.setInt("weights", 0);
+    };
+    Shader blurShader = Shader::deferred("resources/shaders/blur.vs", "resources/shaders/blur.fs");
+    blurShader.onLinked = [](Shader& shader) {
+        shader.use();
+        shader.setInt("image", 0);
+    };
+    rg::ShaderVariants finalShaders("resources/shaders/combined.vs", "resources/shaders/combined.fs",
+                                    {"BLOOM", "HDR", "AUTO_EXPOSURE"},
+                                    [](Shader& shader) {
+                                        shader.use();
+                                        shader.setInt("scene", 0);
+                                        shader.setInt("bloomBlur", 1);
+                                        shader.setInt("autoExposure", 2);
+                                    });
+    litShaders.startAll();//All variants up front, so a toggle in the UI never stalls a frame
+    sunShaders.startAll();
+    skyboxShaders.startAll();
+    finalShaders.startAll();
+
+    //Edited shader files are rebuilt in the background while the old programs keep drawing
+    rg::ShaderWatcher shaderWatcher("resources/shaders");
+    shaderWatcher.add(litShaders);
+    shaderWatcher.add(sunShaders);
+    shaderWatcher.add(skyboxShaders);
+    shaderWatcher.add(depthPrepassShader);
+    shaderWatcher.add(taaShader);
+    shaderWatcher.add(bloomPrefilterShader);
+    shaderWatcher.add(blurShader);
+    shaderWatcher.add(finalShaders);
+    shaderWatcher.add(fxaaShader);
+    shaderWatcher.add(heatmapShader);
+    std::unique_ptr<rg::AutoExposure> autoExposure;
+    if (rg::glExtensions().computeShader) {
+        autoExposure.reset(new rg::AutoExposure());
+        shaderWatcher.add(autoExposure->histogramShader);
+        shaderWatcher.add(autoExposure->averageShader);
+    }
+    shaderWatcher.waitAll();
+    std::cout << "Shaders ready in " << (glfwGetTime() - shaderBuildStart) * 1000.0 << " ms" << std::endl;
+    //GLFW's clock starts at glfwInit, so everything up to the shaders is window, context and ImGui
+    performanceHud.addLoadPhase("context", shaderBuildStart * 1000.0);
+    performanceHud.addLoadPhase("shaders", (glfwGetTime() - shaderBuildStart) * 1000.0);
+    double loadPhaseStart = glfwGetTime();
+    rg::programBinaryCache().report();
 
     // configure (floating point) framebuffers
     // ---------------------------------------
-    unsigned int hdrFBO;
+    // hdrFBO gets a single floating point color buffer and a depth buffer, the half resolution
+    // ping-pong framebuffers for bloom need no depth buffer
     glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    // create 2 floating point color buffers (1 for normal rendering, other for brightness threshold values)
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-    // create and attach depth buffer (renderbuffer)
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
     glGenFramebuffers(2, pingpongFBO);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
+    glGenFramebuffers(2, taaFBO);
+    glGenFramebuffers(1, &ldrFBO);
+    allocateHdrTargets(*programState, SCR_WIDTH, SCR_HEIGHT);
+    performanceHud.addLoadPhase("render targets", (glfwGetTime() - loadPhaseStart) * 1000.0);
+    loadPhaseStart = glfwGetTime();
 
     // load models
     // -----------
-    Model earth_model("resources/objects/earth/scene.gltf");
-    earth_model.SetShaderTextureNamePrefix("material.");
-
-    Model clouds_model("resources/objects/clouds/scene.gltf");
-    clouds_model.SetShaderTextureNamePrefix("material.");
-
-    Model vostok_model("resources/objects/vostok/scene.gltf");
-    vostok_model.SetShaderTextureNamePrefix("material.");
-
-    Model moon_model("resources/objects/moon/scene.gltf");
-    moon_model.SetShaderTextureNamePrefix("material.");
-
-    Model sun_model("resources/objects/sun/scene.gltf");
-    sun_model.SetShaderTextureNamePrefix("");
+    //Models stream in while frames render: each is read and decoded by a job, its textures and buffers are
+    //uploaded on the upload context and the render side starts drawing it once the upload's fence signaled.
+    //Until then it has no meshes and draws nothing.
+    rg::UploadService uploads;
+    if (!uploads.start(window))
+        std::cout << "No shared context for uploads, models upload between frames" << std::endl;
+    Model earth_model, clouds_model, vostok_model, moon_model, sun_model;
+    Model* const models[] = {&earth_model, &clouds_model, &vostok_model, &moon_model, &sun_model};
+    const char* const modelPaths[] = {"resources/objects/earth/scene.gltf", "resources/objects/clouds/scene.gltf",
+                                      "resources/objects/vostok/scene.gltf", "resources/objects/moon/scene.gltf",
+                                      "resources/objects/sun/scene.gltf"};
+    const unsigned int MODEL_COUNT = sizeof(models) / sizeof(models[0]);
+    std::atomic<unsigned int> modelsStreamed(0);
+    std::vector<rg::JobHandle> modelLoads;
+    for (unsigned int i = 0; i < MODEL_COUNT; i++) {
+        Model* model = models[i];
+        const char* path = modelPaths[i];
+        modelLoads.push_back(rg::jobs().schedule([&, model, path]() {
+            model->load(path);
+            uploads.submit([model](rg::StagingBuffer& staging) { model->uploadData(&staging); },
+                           [&, model]() {
+                               model->finishUpload();
+                               if (model == &sun_model) {
+                                   for (Mesh& mesh : sun_model.meshes)
+                                       mesh.material->emissive = 50.0f;//the only thing in the scene bright enough to bloom
+                               }
+                               modelsStreamed++;
+                               redrawRequested = true;
+                               glfwPostEmptyEvent();
+                           });
+        }));
+    }
 
     PointLight& pointLight = programState->pointLight;
     pointLight.position = glm::vec3(0.0, 0.0, 2345.0);
@@ -300,8 +691,10 @@ int main() {
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
     glBindVertexArray(skyboxVAO);
+    rg::labelGLObject(GL_VERTEX_ARRAY, skyboxVAO, "skybox");
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof (skybox_vertices), &skybox_vertices, GL_STATIC_DRAW);
+    rg::gpuMemory().bufferBytes += sizeof(skybox_vertices);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
     glBindVertexArray(0);
@@ -316,63 +709,97 @@ int main() {
 
     unsigned int skybox_texture;
     skybox_texture = loadCubemap(textures_faces);
+    performanceHud.addLoadPhase("skybox", (glfwGetTime() - loadPhaseStart) * 1000.0);
+    loadPhaseStart = glfwGetTime();
+    bool modelsReported = false;
+
+    //The tuning frames are not meant to be seen, the window shows up once it is done. The presets are
+    //measured on the whole scene, the tuning starts once the models streamed in.
+    bool tuningPending = !golden.enabled && programState->tunedFor != rg::deviceFingerprint();
+    if (tuningPending)
+        glfwHideWindow(window);
+    float appliedLodBias = 0.0f;
+
+    rg::RenderQueue renderQueue;
+    rg::GLState& glState = rg::glState();
+    glState.invalidate();//Loading bound textures and buffers without the cache
+
+    //Unjittered view-projections of the last frame and the jitter sequence position, for temporal upscaling
+    glm::mat4 previousViewProjection(1.0f);
+    glm::mat4 previousSkyboxViewProjection(1.0f);
+    unsigned int frameIndex = 0;
+
+    //Update to render side handoff: snapshots go one way and the render side's counters the other, both
+    //through lock-free triple buffers. The mutex only paces the two threads, the update side builds at
+    //most one frame ahead (none in low latency mode, the input is then taken right before the frame is drawn).
+    rg::TripleBuffer<FrameSnapshot> snapshots;
+    rg::TripleBuffer<RenderStats> renderStats;
+    std::mutex renderMutex;
+    std::condition_variable renderCondition;
+    unsigned int snapshotsPublished = 0;
+    unsigned int snapshotsTaken = 0;
+    bool renderWaiting = false;
+    bool renderStop = false;
+    std::atomic<bool> shadersRebuilding(false);
+    //The golden image check captures frames in lockstep with its cases, so it renders on the main thread
+    bool threaded = !golden.enabled && !singleThread;
+
+    //Everything the render side does with a snapshot: it reads nothing else of the update side
+    auto renderFrame = [&](FrameSnapshot& frame) {
+        double renderStart = glfwGetTime();
+        const ProgramState& settings = frame.state;
+        //models that finished uploading are drawn from this frame on, with the current bias
+        bool streamedIn = uploads.poll() > 0;
+        if (streamedIn || settings.lodBias != appliedLodBias) {
+            for (Model* model : models)
+                model->setLodBias(settings.lodBias);
+            appliedLodBias = settings.lodBias;
+        }
 
-    //Setting shader variables
-    blurShader.use();
-    blurShader.setInt("image", 0);
-    finalShader.use();
-    finalShader.setInt("scene", 0);
-    finalShader.setInt("bloomBlur", 1);
-
-    // draw in wireframe
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window)) {
-
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
+        shadersRebuilding = shaderWatcher.update();
+        bool temporal = settings.temporalUpscaling;
+        bool temporalChanged = temporal != allocatedTemporal || (temporal && settings.renderScale != allocatedRenderScale);
+        if (frame.targetWidth != renderWidth || frame.targetHeight != renderHeight || settings.hdrFormat != allocatedHdrFormat
+            || temporalChanged || settings.fxaa != allocatedFxaa)
+            allocateHdrTargets(settings, frame.targetWidth, frame.targetHeight);
+        //The heatmaps show the scene pass as it is drawn, without jitter and with no post-processing
+        rg::HeatmapMode heatmap = (rg::HeatmapMode)settings.heatmap;
+        if (heatmap != rg::HEATMAP_OFF) {
+            temporal = false;
+            historyValid = false;
+        }
+        gpuTimers.pipelineStatistics = settings.pipelineStatistics && rg::glExtensions().pipelineStatistics;
+        gpuTimers.beginFrame();
 
         //Bind hdr framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+        gpuTimers.begin("scene");
+        glState.bindFramebuffer(hdrFBO);
+        glViewport(0, 0, sceneWidth, sceneHeight);
 
         // render
         // ------
-        glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
+        if (heatmap != rg::HEATMAP_OFF)
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            glClearColor(settings.clearColor.r, settings.clearColor.g, settings.clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        //if follow mode is enabled set camera position to follow the capsule
-        glm::mat4 model;
-        if (programState->FollowMode == 1){
-            model = glm::mat4(1.0f);//Doing same transformations as we do for vostok model
-            model = glm::rotate(model, (float)(currentFrame/(800*0.06)), glm::vec3(-1.0,2.0,0.0));
-            model = glm::translate(model, glm::vec3(0.0f, 0.0f, 1.045f));
-
-            programState->camera.Position = glm::vec3(model * glm::vec4(0.0, 0.0, 0.0, 1.0));
-        }
-
-        if (programState->FollowMode == 2){
-            model = glm::mat4(1.0f);//Doing same transformations as we do for moon model
-
-            model = glm::rotate(model, (float)((currentFrame+(800*29))/(800*29)), glm::vec3(sin((float)(24*(M_PI/180))),cos((float)(24*(M_PI/180))),0.0)); //adding rotation around the earth
-            model = glm::translate(model, glm::vec3(0.0f, 0.0f, 58.0));
-
-
-            programState->camera.Position = glm::vec3(model * glm::vec4(0.0, 0.0, 0.0, 1.0));
-        }
-
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.002f, 3000.0f);//Setting near value to a higher value would help with z-fighting issue but then the vostok model would not be visable from up close due to it's small size so a fix is used enlarging the clouds as you get further away from earth
-        glm::mat4 view = programState->camera.GetViewMatrix();
+        glm::mat4 projection = frame.projection;
+        const glm::mat4& view = frame.view;
+        //Motion vectors are measured without the jitter, so they only contain the real movement
+        glm::mat4 viewProjection = projection * view;
+        glm::mat4 skyboxViewProjection = projection * glm::mat4(glm::mat3(view));
+        glm::vec2 jitter(0.0f);
+        if (temporal) {
+            jitter = rg::temporalJitter(frameIndex);
+            projection = rg::jitterProjection(projection, jitter, sceneWidth, sceneHeight);
+        }
+        frameIndex++;
 
+        const PointLight& pointLight = settings.pointLight;
+        bool heatmapped = heatmap != rg::HEATMAP_OFF;
+        Shader& ourShader = litShaders.get({settings.enable_fong, temporal, heatmapped});
         ourShader.use();
         ourShader.setVec3("pointLight.position", pointLight.position);
         ourShader.setVec3("pointLight.ambient", pointLight.ambient);
@@ -381,143 +808,468 @@ int main() {
         ourShader.setFloat("pointLight.constant", pointLight.constant);
         ourShader.setFloat("pointLight.linear", pointLight.linear);
         ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
+        ourShader.setVec3("viewPosition", settings.camera.Position);
         ourShader.setFloat("material.shininess", 8.0f);
-        ourShader.setInt("enable_fong", programState->enable_fong);
         ourShader.setMat4("projection", projection);
         ourShader.setMat4("view", view);
+        ourShader.setMat4("currentViewProjection", viewProjection);
+        ourShader.setMat4("previousViewProjection", previousViewProjection);
 
 
-        // earth model radius 1, moon model radius 1, vostok model radius ~ 1.3, sun model radius 1
-        // earth radius - 6378 km = 1, 23*(M_PI/180) tilt of orbit, vostok orbit ~ 250km (6628 km) = 1.04, vostok size 0.005 km = 0.0000008, vostok orbital period = 0,06 d
-        // moon orbit 384 000 km = 60, moon radius 0.27 of earth, moon orbital period = 29 d, 24*(M_PI/180) tilt of orbit (to equator of earth)
-        // sun distance 149,600,000 km = 23455, sun radius 109 x earth radius
-
-        glEnable(GL_BLEND); //Enabling blending to render clouds properly
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        // earth and clouds rendering
-        ourShader.use();
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, (float)(currentFrame/800), glm::vec3(0.0,1.0,0.0)); //Implementing Earth rotation around its axis
-        model = glm::rotate(model, (float)(-M_PI/2), glm::vec3(1.0,0.0,0.0)); //Fixing model wrong orientation
-        model = glm::scale(model, glm::vec3(1));
-        ourShader.setMat4("model", model);
-
-        earth_model.Draw(ourShader);
-
-        //another option is to make a separate shader and have distance passed to it and make the alpha value = alpha^1/distance so that the clouds become more transparent the further you distance yourself from earth
-        float distance_to_camera = glm::distance(programState->camera.Position, glm::vec3(model * glm::vec4(0.0, 0.0, 0.0, 1.0)));//if distance is large z-fighting is noticable so we dont render the clouds
-        if (distance_to_camera < 75) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, (float) (currentFrame / 800),
-                                glm::vec3(0.0, 1.0, 0.0)); //Implementing Earth rotation around its axis
-            model = glm::rotate(model, (float) (-M_PI / 2), glm::vec3(1.0, 0.0, 0.0)); //Fixing model wrong orientation
-            model = glm::scale(model, glm::vec3(1.002 + (distance_to_camera / 400)));//fix to z fighting
-            ourShader.setMat4("model", model);
-
-            clouds_model.Draw(ourShader);
-        }
-
-        glDisable(GL_BLEND); //Blending should only affect earth and the clouds, another way is to calculate distance to each object and draw them in the sorted order
-
-        //vostok rendering
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-
-        model = glm::rotate(model, (float)(currentFrame/(800*0.06)), glm::vec3(-1.0,2.0,0.0)); //Adding rotation around the earth
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 1.04f));//orbit made slightly bigger because it looks nicer
-        model = glm::rotate(model, (float)((currentFrame+(800*0.1*3))/(800*0.1)), glm::vec3(-1.0,2.0,-3.0)); //Adding small rotation to the model
-        model = glm::scale(model, glm::vec3(1*0.00008));//Model is bigger than it should be to avoid float precision issues
-        ourShader.setMat4("model", model);
-
-        vostok_model.Draw(ourShader);
+        //Models are only submitted here, the queue sorts them (opaque front to back, blended back to front) and draws them after the sun
+        renderQueue.begin(settings.camera.Position);
+        renderQueue.motionVectors = temporal;
+        renderQueue.heatmap = heatmap;
+        renderQueue.setShaderCost(ourShader, LIT_SHADER_COST);
 
-        //moon rendering
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)((currentFrame+(800*29))/(800*29)), glm::vec3(sin((float)(24*(M_PI/180))),cos((float)(24*(M_PI/180))),0.0)); //adding rotation around the earth
+        // earth and clouds rendering - blended to render clouds properly
+        renderQueue.submit(rg::RENDER_PASS_BLENDED, ourShader, earth_model, frame.earth);
+        if (frame.drawClouds)
+            renderQueue.submit(rg::RENDER_PASS_BLENDED, ourShader, clouds_model, frame.clouds);
 
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 60.0));
+        renderQueue.submit(rg::RENDER_PASS_OPAQUE, ourShader, vostok_model, frame.vostok);
+        renderQueue.submit(rg::RENDER_PASS_OPAQUE, ourShader, moon_model, frame.moon);
 
-        model = glm::rotate(model, (float)(currentFrame/(800*29)), glm::vec3(0.0,1.0,0.0)); //adding rotation around itself
-        model = glm::rotate(model, (float)(-M_PI/2), glm::vec3(1.0,0.0,0.0)); //Fixing model wrong orientation
-        model = glm::scale(model, glm::vec3(0.27));
-        ourShader.setMat4("model", model);
-
-        moon_model.Draw(ourShader);
-
-        //sun rendering
-        //sun size and distance not correct - due to float precision there were some glitches when put to proper values; Sun is here 10x closer and scaled to look ok
+        Shader& sunShader = sunShaders.get({temporal, heatmapped});
         sunShader.use();
         sunShader.setMat4("projection", projection);
         sunShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 2345.0f));
-        model = glm::scale(model, glm::vec3(20.0));
-        sunShader.setMat4("model", model);
-
-        sun_model.Draw(sunShader);
+        sunShader.setMat4("currentViewProjection", viewProjection);
+        sunShader.setMat4("previousViewProjection", previousViewProjection);
+        renderQueue.submit(rg::RENDER_PASS_OPAQUE, sunShader, sun_model, frame.sun);
+        renderQueue.setShaderCost(sunShader, SUN_SHADER_COST);
+
+        Shader* depthPrepass = nullptr;
+        if (settings.depthPrepass) {
+            depthPrepass = &depthPrepassShader;
+            depthPrepassShader.use();
+            depthPrepassShader.setMat4("projection", projection);
+            depthPrepassShader.setMat4("view", view);
+        }
+        renderQueue.flush(depthPrepass);
+        gpuTimers.end();
 
         //drawing the skybox
-        glDepthFunc(GL_LEQUAL);
+        gpuTimers.begin("skybox");
+        glState.disable(GL_BLEND);
+        glState.depthFunc(GL_LEQUAL);
+        Shader& skyboxShader = skyboxShaders.get({temporal, heatmapped});
         skyboxShader.use();
+        if (heatmapped) {
+            glState.enable(GL_BLEND);
+            glState.blendFunc(GL_ONE, GL_ONE);
+            skyboxShader.setFloat("heatmapWeight", heatmap == rg::HEATMAP_OVERDRAW ? 1.0f : SKYBOX_SHADER_COST);
+        }
         skyboxShader.setMat4("projection", projection);
         skyboxShader.setMat4("view", glm::mat4(glm::mat3(view)));
-        glBindVertexArray(skyboxVAO);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture);
+        skyboxShader.setMat4("currentViewProjection", skyboxViewProjection);
+        skyboxShader.setMat4("previousViewProjection", previousSkyboxViewProjection);
+        glState.bindVertexArray(skyboxVAO);
+        glState.bindTexture(0, GL_TEXTURE_CUBE_MAP, skybox_texture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        rg::glCalls().countDraw(12);
+        glState.depthFunc(GL_LESS);
+        glState.disable(GL_BLEND);
+        gpuTimers.end();
+
+        //Temporal upscaling: reconstruct the full resolution image from this frame and the reprojected history
+        unsigned int sceneTexture = colorBuffer;
+        if (temporal) {
+            gpuTimers.begin("temporal");
+            glViewport(0, 0, renderWidth, renderHeight);
+            glState.bindFramebuffer(taaFBO[historyIndex]);
+            taaShader.use();
+            taaShader.setVec2("jitter", jitter.x / sceneWidth, jitter.y / sceneHeight);
+            taaShader.setBool("historyValid", historyValid);
+            taaShader.setFloat("feedback", 0.1f);
+            glState.bindTexture(0, GL_TEXTURE_2D, colorBuffer);
+            glState.bindTexture(1, GL_TEXTURE_2D, motionBuffer);
+            glState.bindTexture(2, GL_TEXTURE_2D, historyBuffers[1 - historyIndex]);
+            renderQuad();
+            sceneTexture = historyBuffers[historyIndex];
+            historyIndex = 1 - historyIndex;
+            historyValid = true;
+            gpuTimers.end();
+        }
+        previousViewProjection = viewProjection;
+        previousSkyboxViewProjection = skyboxViewProjection;
+
+        //Measure the scene brightness for the tone mapper, all on the GPU
+        bool autoExposed = autoExposure && settings.autoExposure && settings.enable_HDR && !heatmapped;
+        if (autoExposed) {
+            gpuTimers.begin("exposure");
+            autoExposure->settings.adaptationSpeed = settings.adaptationSpeed;
+            autoExposure->update(sceneTexture, renderWidth, renderHeight, frame.deltaTime);
+            gpuTimers.end();
+        }
 
-        //Blur bright parts with 2-pass Gauss
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 20;
+        //Extract the bright parts while downsampling to half resolution, then blur them with 2-pass Gauss
+        bool horizontal = true;
+        bool bloom = settings.enable_bloom && !heatmapped;
+        //Half resolution doubles the reach of every pass
+        unsigned int amount = bloom ? settings.bloomPasses : 0;//The no-bloom variant of the final shader never reads the result
+        if (bloom) {
+            gpuTimers.begin("bloom");
+            glViewport(0, 0, bloomWidth, bloomHeight);
+            glState.bindFramebuffer(pingpongFBO[0]);
+            bloomPrefilterShader.use();
+            bloomPrefilterShader.setFloat("threshold", settings.bloomThreshold);
+            bloomPrefilterShader.setFloat("knee", settings.bloomKnee);
+            glState.bindTexture(0, GL_TEXTURE_2D, sceneTexture);
+            renderQuad();
+        }
         blurShader.use();
         for (unsigned int i = 0; i < amount; i++)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+            glState.bindFramebuffer(pingpongFBO[horizontal]);
             blurShader.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+            glState.bindTexture(0, GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer
             renderQuad();
             horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (bloom)
+            gpuTimers.end();
+
+        if (heatmapped) {
+            gpuTimers.begin("heatmap");
+            glState.disable(GL_BLEND);
+            glState.bindFramebuffer(0);
+            glViewport(0, 0, frame.windowWidth, frame.windowHeight);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            heatmapShader.use();
+            heatmapShader.setFloat("maxWeight", settings.heatmapScale);
+            glState.bindTexture(0, GL_TEXTURE_2D, colorBuffer);
+            renderQuad();
+            gpuTimers.end();
+        } else {
+            //Tone mapping, straight to the window or into the LDR target for FXAA
+            gpuTimers.begin("tonemap");
+            if (allocatedFxaa) {
+                glState.bindFramebuffer(ldrFBO);
+                glViewport(0, 0, renderWidth, renderHeight);
+            } else {
+                glState.bindFramebuffer(0);
+                glViewport(0, 0, frame.windowWidth, frame.windowHeight);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            }
+            Shader& finalShader = finalShaders.get({bloom, settings.enable_HDR, autoExposed});
+            finalShader.use();
+            glState.bindTexture(0, GL_TEXTURE_2D, sceneTexture);
+            glState.bindTexture(1, GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
+            if (autoExposed)
+                glState.bindTexture(2, GL_TEXTURE_2D, autoExposure->exposureTexture());
+            finalShader.setFloat("exposure", settings.exposure);
+            renderQuad();
+            gpuTimers.end();
+        }
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        finalShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-        finalShader.setInt("bloom", programState->enable_bloom);
-        finalShader.setInt("HDR", programState->enable_HDR);
-        finalShader.setFloat("exposure", programState->exposure);
-        renderQuad();
-
-        if (programState->ImGuiEnabled)
-            DrawImGui(programState);
-
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
+        if (allocatedFxaa && !heatmapped) {
+            gpuTimers.begin("fxaa");
+            glState.bindFramebuffer(0);
+            glViewport(0, 0, frame.windowWidth, frame.windowHeight);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            const FxaaPreset& preset = FXAA_PRESETS[settings.fxaaQuality];
+            fxaaShader.use();
+            fxaaShader.setFloat("edgeThreshold", preset.edgeThreshold);
+            fxaaShader.setFloat("edgeThresholdMin", preset.edgeThresholdMin);
+            fxaaShader.setFloat("subpixel", preset.subpixel);
+            fxaaShader.setInt("searchSteps", preset.searchSteps);
+            glState.bindTexture(0, GL_TEXTURE_2D, ldrBuffer);
+            renderQuad();
+            gpuTimers.end();
+        }
+
+        //Read back before ImGui draws over the image
+        if (golden.enabled && captureGoldenFrame(frame.windowWidth, frame.windowHeight))
+            glfwSetWindowShouldClose(window, true);
+
+        {
+            uint64_t pixels = (uint64_t)renderWidth * renderHeight;
+            uint64_t windowPixels = (uint64_t)frame.windowWidth * frame.windowHeight;
+            uint64_t bloomPixels = bloom ? (uint64_t)bloomWidth * bloomHeight : 0;
+            uint64_t bpp = rg::HDR_FORMATS[allocatedHdrFormat].bytesPerPixel;
+            frameBandwidth.clear();
+            uint64_t scenePixels = (uint64_t)sceneWidth * sceneHeight;
+            //color target and the depth buffer, plus the RG16F motion vectors with temporal upscaling
+            frameBandwidth.add("scene", 0, scenePixels * (bpp + 4 + (temporal ? 4 : 0)));
+            if (temporal)
+                frameBandwidth.add("temporal", scenePixels * (bpp + 4) + pixels * bpp, pixels * bpp);
+            if (autoExposed)
+                frameBandwidth.add("exposure", pixels / 4 * bpp, 0);//a bilinear tap per 4x4 block
+            if (bloom)
+                frameBandwidth.add("prefilter", pixels * bpp, bloomPixels * bpp);
+            frameBandwidth.add("blur", amount * bloomPixels * bpp, amount * bloomPixels * bpp);
+            if (allocatedFxaa && !heatmapped) {
+                frameBandwidth.add("final", pixels * bpp + bloomPixels * bpp, pixels * 4);
+                frameBandwidth.add("fxaa", pixels * 4, windowPixels * 4);
+            } else {
+                frameBandwidth.add("final", pixels * bpp + bloomPixels * bpp, windowPixels * 4);
+            }
+        }
+
+        if (frame.ui.valid) {
+            ImGui_ImplOpenGL3_RenderDrawData(&frame.ui.drawData);
+            glState.invalidate();//ImGui restores the state it changes, but does it behind the cache's back
+        }
+        float renderMs = (glfwGetTime() - renderStart) * 1000.0f;
+        glState.endFrame();
+        rg::glCalls().endFrame();
+        renderTargets.endFrame();
+
+        RenderStats& stats = renderStats.writeBuffer();
+        stats.passTimings = gpuTimers.results();
+        stats.pipelineStatistics = gpuTimers.pipelineStatistics;
+        stats.gpuMs = gpuTimers.totalMilliseconds();
+        //the two sides overlap when threaded, the slower one then bounds the frame rate
+        stats.cpuMs = threaded ? std::max(frame.updateMs, renderMs) : frame.updateMs + renderMs;
+        stats.bandwidth = frameBandwidth;
+        stats.glStateCalls = glState.lastFrame;
+        stats.glCalls = rg::glCalls().lastFrame;
+        stats.renderTargets = renderTargets.stats();
+        stats.renderWidth = renderWidth;
+        stats.renderHeight = renderHeight;
+
+
+        // glfw: swap buffers
+        // ------------------
         glfwSwapBuffers(window);
+        framePacer.endFrame(frame.inputTime);
+        stats.inputLatencyMs = framePacer.inputLatencyMs();
+        stats.framesInFlight = framePacer.framesInFlight();
+        renderStats.publish();
+        //for the next beginFrame()
+        framePacer.maxFramesInFlight = settings.lowLatency ? settings.maxFramesInFlight : 0;
+        framePacer.frameLimit = settings.frameLimit;
+    };
+
+    //The golden images are of the whole scene
+    if (golden.enabled) {
+        while (modelsStreamed < MODEL_COUNT) {
+            uploads.poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    //The render thread owns the context from here on; ImGui's device objects are created up front so that
+    //building its frames on the main thread never touches GL
+    std::thread renderThread;
+    if (threaded) {
+        ImGui_ImplOpenGL3_CreateDeviceObjects();
+        glfwMakeContextCurrent(NULL);
+        renderThread = std::thread([&]() {
+            rg::setThreadName("rg-render");
+            glfwMakeContextCurrent(window);
+            while (true) {
+                framePacer.beginFrame();
+                std::unique_lock<std::mutex> lock(renderMutex);
+                renderWaiting = true;
+                renderCondition.notify_all();
+                while (!renderStop && snapshotsTaken == snapshotsPublished) {
+                    if (renderCondition.wait_for(lock, std::chrono::duration<double>(ON_DEMAND_WAIT_SECONDS)) == std::cv_status::timeout) {
+                        //idle with on-demand rendering, edited shaders are still picked up
+                        lock.unlock();
+                        shadersRebuilding = shaderWatcher.update();
+                        if (shadersRebuilding)
+                            glfwPostEmptyEvent();
+                        lock.lock();
+                    }
+                }
+                if (renderStop)
+                    break;
+                renderWaiting = false;
+                snapshotsTaken = snapshotsPublished;
+                lock.unlock();
+                renderCondition.notify_all();
+                snapshots.take();
+                renderFrame(snapshots.readBuffer());
+            }
+            glfwMakeContextCurrent(NULL);
+        });
+    }
+
+    //Update side state: the size the render targets follow, and what the last snapshot showed for on-demand rendering
+    unsigned int targetWidth = SCR_WIDTH;
+    unsigned int targetHeight = SCR_HEIGHT;
+    glm::mat4 lastViewProjection(1.0f);
+    float lastSimulationTime = 0.0f;
+    unsigned int framesToSettle = 0;
+
+    // draw in wireframe
+    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    // render loop
+    // -----------
+    while (!glfwWindowShouldClose(window)) {
+        //Startup ends with the last model, the time it took on top of the rest of the loading
+        if (!modelsReported && modelsStreamed == MODEL_COUNT) {
+            performanceHud.addLoadPhase("models", (glfwGetTime() - loadPhaseStart) * 1000.0);
+            modelsReported = true;
+            //the peak is what loading cost, the rest is what the scene keeps on the CPU
+            rg::ProcessMemory memory = rg::processMemory();
+            performanceHud.setStartupMemory(memory);
+            std::cout << "Memory after loading: " << memory.residentBytes / 1e6 << " MB resident, peak "
+                      << memory.peakResidentBytes / 1e6 << " MB" << std::endl;
+            if (tuningPending) {
+                startAutoTuning();
+                tuningPending = false;
+            }
+        }
+        if (programState->onDemand && !golden.enabled && !autoTuner.running()) {
+            if (!threaded)
+                shadersRebuilding = shaderWatcher.update();
+            if (shadersRebuilding || redrawRequested)
+                framesToSettle = ON_DEMAND_SETTLE_FRAMES;
+            redrawRequested = false;
+            //a follow mode moves the camera with the orbit, a held key moves it every frame
+            bool moving = programState->FollowMode != 0 || movementKeysHeld(window)
+                          || screenMotion(lastViewProjection, lastSimulationTime, glfwGetTime()) > programState->redrawThreshold;
+            bool resizing = SCR_WIDTH != targetWidth || SCR_HEIGHT != targetHeight;
+            //uploads complete in the render side's frames
+            bool streaming = modelsStreamed < MODEL_COUNT;
+            if (framesToSettle == 0 && !moving && !resizing && !streaming) {
+                glfwWaitEventsTimeout(ON_DEMAND_WAIT_SECONDS);
+                lastFrame = glfwGetTime();//the frame after the wait moves the camera by one frame, not by the wait
+                continue;
+            }
+            if (framesToSettle > 0)
+                framesToSettle--;
+        }
+
+        if (threaded) {
+            std::unique_lock<std::mutex> lock(renderMutex);
+            renderCondition.wait(lock, [&]() {
+                return snapshotsTaken == snapshotsPublished && (renderWaiting || !programState->lowLatency);
+            });
+        } else {
+            framePacer.beginFrame();
+        }
+        //Polled only now, after the wait for the render side, so the frame is built from the newest input
         glfwPollEvents();
+
+        // per-frame time logic
+        // --------------------
+        float currentFrame = glfwGetTime();
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        // input
+        // -----
+        processInput(window);
+
+        //The scene moves with the simulation time, which the golden image check pins
+        float simulationTime = currentFrame;
+        if (golden.enabled) {
+            simulationTime = GOLDEN_TIME;
+            deltaTime = 1.0f / 60.0f;
+            applyGoldenCase();
+        } else if (autoTuner.running()) {
+            simulationTime = GOLDEN_TIME;
+            std::vector<GoldenViewpoint> viewpoints = goldenViewpoints();
+            programState->camera = viewpointCamera(viewpoints[autoTuner.frame() * viewpoints.size() / rg::AutoTuner::FRAMES_PER_PRESET]);
+        }
+        if ((SCR_WIDTH != targetWidth || SCR_HEIGHT != targetHeight) && ++framesSinceResize >= RESIZE_SETTLE_FRAMES) {
+            targetWidth = SCR_WIDTH;
+            targetHeight = SCR_HEIGHT;
+        }
+
+        //The counters of the newest frame the render side finished, for the UI, the HUD and the tuner
+        bool statsArrived = renderStats.take();
+        const RenderStats& stats = renderStats.readBuffer();
+        if (statsArrived) {
+            performanceHud.record(deltaTime * 1000.0f, stats.cpuMs, stats.gpuMs);
+            if (autoTuner.running() && autoTuner.record(stats.cpuMs, stats.gpuMs)) {
+                std::cout << "Quality preset " << QUALITY_PRESETS[programState->qualityPreset].name << ": "
+                          << autoTuner.measuredMs() << " ms" << std::endl;
+                applyQualityPreset(autoTuner.preset());
+                if (!autoTuner.running()) {
+                    programState->tunedFor = rg::deviceFingerprint();
+                    programState->camera = cameraBeforeTuning;
+                    programState->SaveToFile("resources/program_state.txt");
+                    glfwShowWindow(window);
+                }
+            }
+        }
+
+        FrameSnapshot& frame = snapshots.writeBuffer();
+        frame.ui.clear();
+        if (programState->ImGuiEnabled || performanceHud.visible) {
+            DrawImGui(programState, stats);
+            frame.ui.capture(ImGui::GetDrawData());
+        }
+
+        //if follow mode is enabled set camera position to follow the capsule
+        if (programState->FollowMode == 1)
+            programState->camera.Position = rg::vostokFollowPosition(simulationTime);
+        if (programState->FollowMode == 2)
+            programState->camera.Position = rg::moonFollowPosition(simulationTime);
+
+        //Late latch: the input up to here is in the camera the frame is drawn with
+        frame.inputTime = framePacer.latchInput();
+        frame.state = *programState;
+        frame.simulationTime = simulationTime;
+        frame.deltaTime = deltaTime;
+        frame.windowWidth = SCR_WIDTH;
+        frame.windowHeight = SCR_HEIGHT;
+        frame.targetWidth = targetWidth;
+        frame.targetHeight = targetHeight;
+        frame.projection = glm::perspective(glm::radians(programState->camera.Zoom),
+                                            (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.002f, 3000.0f);//Setting near value to a higher value would help with z-fighting issue but then the vostok model would not be visable from up close due to it's small size so a fix is used enlarging the clouds as you get further away from earth
+        frame.view = programState->camera.GetViewMatrix();
+        frame.earth = rg::earthModel(simulationTime);
+        //another option is to make a separate shader and have distance passed to it and make the alpha value = alpha^1/distance so that the clouds become more transparent the further you distance yourself from earth
+        float distance_to_camera = glm::distance(programState->camera.Position, glm::vec3(frame.earth * glm::vec4(0.0, 0.0, 0.0, 1.0)));//if distance is large z-fighting is noticable so we dont render the clouds
+        frame.drawClouds = distance_to_camera < 75;
+        frame.clouds = rg::cloudsModel(simulationTime, distance_to_camera);
+        frame.vostok = rg::vostokModel(simulationTime);
+        frame.moon = rg::moonModel(simulationTime);
+        frame.sun = rg::sunModel();
+        frame.updateMs = (glfwGetTime() - currentFrame) * 1000.0f;
+        lastViewProjection = frame.projection * frame.view;
+        lastSimulationTime = simulationTime;
+        snapshots.publish();
+
+        if (threaded) {
+            {
+                std::lock_guard<std::mutex> lock(renderMutex);
+                snapshotsPublished++;
+            }
+            renderCondition.notify_all();
+        } else {
+            snapshots.take();
+            renderFrame(snapshots.readBuffer());
+        }
+    }
+
+    if (threaded) {
+        {
+            std::lock_guard<std::mutex> lock(renderMutex);
+            renderStop = true;
+        }
+        renderCondition.notify_all();
+        renderThread.join();
+        glfwMakeContextCurrent(window);
     }
+    //Loads still running hand their uploads to the service
+    for (const rg::JobHandle& load : modelLoads)
+        rg::jobs().wait(load);
+    uploads.stop();
 
-    programState->SaveToFile("resources/program_state.txt");
+    if (!golden.enabled)
+        programState->SaveToFile("resources/program_state.txt");
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
+    autoExposure.reset();//its GL objects have to go while the context is still there
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
+    if (golden.enabled) {
+        std::cout << "[golden] " << golden.failures << " of " << GOLDEN_MODE_COUNT * goldenViewpoints().size() << " cases failed, "
+                  << golden.missing << " had no reference" << std::endl;
+        if (golden.failures > 0)
+            return 1;
+        return golden.missing > 0 ? GOLDEN_SKIPPED : 0;
+    }
     return 0;
 }
 
@@ -546,37 +1298,264 @@ void processInput(GLFWwindow *window) {
         programState->camera.ProcessRotation(1.0);
 }
 
+// the keys processInput reacts to while they are held
+// ---------------------------------------------------------------------------------------------
+bool movementKeysHeld(GLFWwindow *window) {
+    for (int key : {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E}) {
+        if (glfwGetKey(window, key) == GLFW_PRESS)
+            return true;
+    }
+    return false;
+}
+
+// the furthest a point on a moving body travelled on screen between the two simulation times, in pixels
+// ---------------------------------------------------------------------------------------------
+float screenMotion(const glm::mat4& viewProjection, float fromTime, float toTime) {
+    glm::vec3 from[rg::MOTION_PROBE_COUNT];
+    glm::vec3 to[rg::MOTION_PROBE_COUNT];
+    rg::motionProbes(fromTime, from);
+    rg::motionProbes(toTime, to);
+    glm::vec2 halfScreen(SCR_WIDTH * 0.5f, SCR_HEIGHT * 0.5f);
+    float motion = 0.0f;
+    for (unsigned int i = 0; i < rg::MOTION_PROBE_COUNT; i++) {
+        glm::vec4 a = viewProjection * glm::vec4(from[i], 1.0f);
+        glm::vec4 b = viewProjection * glm::vec4(to[i], 1.0f);
+        if (a.w <= 0.0f || b.w <= 0.0f)
+            continue;//behind the camera
+        glm::vec2 ndcMotion(b.x / b.w - a.x / a.w, b.y / b.w - a.y / a.w);
+        motion = std::max(motion, glm::length(ndcMotion * halfScreen));
+    }
+    return motion;
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-    // make sure the viewport matches the new window dimensions; note that width and
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    redrawRequested = true;
+    // the viewport is set every frame, the render targets follow once resizing stops;
+    // note that width and height will be significantly larger than specified on retina displays.
     SCR_WIDTH = width;
     SCR_HEIGHT = height;//Setting width and height so that perspective remains the same
+    framesSinceResize = 0;
+}
 
+// (re)acquires the scene and bloom targets for the size and the settings' HDR format and attaches them
+// ---------------------------------------------------------------------------------------------
+void allocateHdrTargets(const ProgramState& settings, unsigned int width, unsigned int height) {
+    if (renderWidth != 0) {
+        renderTargets.releaseTexture(colorBuffer);
+        renderTargets.releaseTexture(pingpongColorbuffers[0]);
+        renderTargets.releaseTexture(pingpongColorbuffers[1]);
+        renderTargets.releaseDepth(rboDepth);
+    }
+    if (allocatedFxaa)
+        renderTargets.releaseTexture(ldrBuffer);
+    if (allocatedTemporal) {
+        renderTargets.releaseTexture(motionBuffer);
+        renderTargets.releaseTexture(historyBuffers[0]);
+        renderTargets.releaseTexture(historyBuffers[1]);
+    }
+    renderWidth = width;
+    renderHeight = height;
+    allocatedTemporal = settings.temporalUpscaling;
+    allocatedFxaa = settings.fxaa;
+    allocatedRenderScale = settings.renderScale;
+    sceneWidth = allocatedTemporal ? std::max(1u, (unsigned int)(renderWidth * allocatedRenderScale)) : renderWidth;
+    sceneHeight = allocatedTemporal ? std::max(1u, (unsigned int)(renderHeight * allocatedRenderScale)) : renderHeight;
+    historyValid = false;
+    bloomWidth = std::max(1u, renderWidth / 2);
+    bloomHeight = std::max(1u, renderHeight / 2);
+    allocatedHdrFormat = settings.hdrFormat;
+
+    const rg::HdrFormat& format = rg::HDR_FORMATS[allocatedHdrFormat];
+    colorBuffer = renderTargets.acquireTexture(format.internalFormat, format.format, sceneWidth, sceneHeight);
+    rboDepth = renderTargets.acquireDepth(sceneWidth, sceneHeight);
+    if (allocatedTemporal) {
+        motionBuffer = renderTargets.acquireTexture(GL_RG16F, GL_RG, sceneWidth, sceneHeight);
+        for (unsigned int i = 0; i < 2; i++)
+            historyBuffers[i] = renderTargets.acquireTexture(format.internalFormat, format.format, renderWidth, renderHeight);
+    }
+    for (unsigned int i = 0; i < 2; i++)
+        pingpongColorbuffers[i] = renderTargets.acquireTexture(format.internalFormat, format.format, bloomWidth, bloomHeight);
 
-    for (unsigned int i = 0; i < 2; i++)//resizing textures and depth buffer when resizing window
+    rg::GLState& state = rg::glState();
+    state.bindFramebuffer(hdrFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, allocatedTemporal ? motionBuffer : 0, 0);
+    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(allocatedTemporal ? 2 : 1, attachments);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Framebuffer not complete!" << std::endl;
+    for (unsigned int i = 0; i < 2; i++)
     {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        //Im not sure if this will free up the memory that was used before - but i feel it should
-        //Tryed to look for some information online but unfortunately couldnt find anything - tested it with large number of glTexImage2D calls and it worked fine
+        state.bindFramebuffer(pingpongFBO[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Framebuffer not complete!" << std::endl;
     }
+    if (allocatedFxaa)
+    {
+        ldrBuffer = renderTargets.acquireTexture(GL_RGBA8, GL_RGBA, renderWidth, renderHeight);
+        state.bindFramebuffer(ldrFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ldrBuffer, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Framebuffer not complete!" << std::endl;
+    }
+    if (allocatedTemporal)
+    {
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            state.bindFramebuffer(taaFBO[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, historyBuffers[i], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Framebuffer not complete!" << std::endl;
+        }
+    }
+    //Pooled targets change roles, so they are labelled again on every allocation
+    const char* const pairNames[2][2] = {{"bloom 0", "bloom 1"}, {"history 0", "history 1"}};
+    rg::labelGLObject(GL_FRAMEBUFFER, hdrFBO, "scene");
+    rg::labelGLObject(GL_TEXTURE, colorBuffer, "scene color");
+    rg::labelGLObject(GL_RENDERBUFFER, rboDepth, "scene depth");
+    for (unsigned int i = 0; i < 2; i++) {
+        rg::labelGLObject(GL_FRAMEBUFFER, pingpongFBO[i], pairNames[0][i]);
+        rg::labelGLObject(GL_TEXTURE, pingpongColorbuffers[i], pairNames[0][i]);
+        //a framebuffer name only becomes an object, which a label needs, once it was bound
+        if (allocatedTemporal) {
+            rg::labelGLObject(GL_FRAMEBUFFER, taaFBO[i], pairNames[1][i]);
+            rg::labelGLObject(GL_TEXTURE, historyBuffers[i], pairNames[1][i]);
+        }
+    }
+    if (allocatedTemporal)
+        rg::labelGLObject(GL_TEXTURE, motionBuffer, "motion vectors");
+    if (allocatedFxaa) {
+        rg::labelGLObject(GL_FRAMEBUFFER, ldrFBO, "ldr");
+        rg::labelGLObject(GL_TEXTURE, ldrBuffer, "ldr color");
+    }
+    state.bindFramebuffer(0);
+}
 
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
+// the golden image viewpoints at GOLDEN_TIME, looking at the bodies where they are then
+// ---------------------------------------------------------------------------------------------
+std::vector<GoldenViewpoint> goldenViewpoints() {
+    glm::vec4 origin(0.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec3 vostok = glm::vec3(rg::vostokModel(GOLDEN_TIME) * origin);
+    glm::vec3 moon = glm::vec3(rg::moonModel(GOLDEN_TIME) * origin);
+    glm::vec3 sun = glm::vec3(rg::sunModel() * origin);
+    return {
+            {"earth", glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f)},
+            {"capsule", vostok + glm::normalize(glm::vec3(1.0f, 0.4f, 1.0f)) * 0.003f, vostok},//just beyond the near plane
+            {"moon", rg::moonFollowPosition(GOLDEN_TIME), moon},
+            {"sun", glm::vec3(0.0f, 0.0f, 3.0f), sun}
+    };
+}
 
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+// a camera at the viewpoint, looking at its target
+// ---------------------------------------------------------------------------------------------
+Camera viewpointCamera(const GoldenViewpoint& viewpoint) {
+    glm::vec3 direction = glm::normalize(viewpoint.target - viewpoint.position);
+    return Camera(viewpoint.position, glm::vec3(0.0f, 1.0f, 0.0f),
+                  glm::degrees(std::atan2(direction.z, direction.x)), glm::degrees(std::asin(direction.y)));
+}
+
+// measures the quality presets from the top, the camera comes back once the tuner picked one
+// ---------------------------------------------------------------------------------------------
+void startAutoTuning() {
+    cameraBeforeTuning = programState->camera;
+    autoTuner.start(QUALITY_PRESET_COUNT, programState->targetFrameMs);
+    applyQualityPreset(autoTuner.preset());
+}
+
+void applyQualityPreset(int preset) {
+    const QualityPreset& quality = QUALITY_PRESETS[preset];
+    programState->qualityPreset = preset;
+    programState->bloomPasses = quality.bloomPasses;
+    programState->temporalUpscaling = quality.temporalUpscaling;
+    programState->renderScale = quality.renderScale;
+    programState->hdrFormat = quality.hdrFormat;
+    programState->lodBias = quality.lodBias;
+    programState->fxaa = quality.fxaa;
+    programState->fxaaQuality = quality.fxaaQuality;
+}
+
+// puts the camera and the settings of the current golden case in place, every frame of the case
+// ---------------------------------------------------------------------------------------------
+void applyGoldenCase() {
+    const GoldenViewpoint viewpoint = goldenViewpoints()[golden.viewpoint];
+    const GoldenMode& mode = GOLDEN_MODES[golden.mode];
+    programState->camera = viewpointCamera(viewpoint);
+    programState->FollowMode = 0;
+    programState->ImGuiEnabled = false;
+    programState->heatmap = rg::HEATMAP_OFF;
+    programState->autoExposure = false;//adapts over time, the fixed exposure keeps the image reproducible
+    programState->hdrFormat = mode.hdrFormat;
+    programState->temporalUpscaling = mode.temporalUpscaling;
+    programState->fxaa = mode.fxaa;
+    programState->depthPrepass = mode.depthPrepass;
+    programState->fxaaQuality = 1;
+    programState->renderScale = 0.67f;
+    programState->bloomPasses = 6;
+    programState->lodBias = 0.0f;
+}
+
+// reads the window back on the last frame of a case and checks it against the reference (or writes the
+// reference with --golden-update); true once every case ran
+// ---------------------------------------------------------------------------------------------
+bool captureGoldenFrame(unsigned int width, unsigned int height) {
+    if (++golden.frame < GOLDEN_SETTLE_FRAMES)
+        return false;
+    golden.frame = 0;
+    std::vector<GoldenViewpoint> viewpoints = goldenViewpoints();
+    const GoldenViewpoint& viewpoint = viewpoints[golden.viewpoint];
+    const GoldenMode& mode = GOLDEN_MODES[golden.mode];
+    std::string name = std::string(viewpoint.name) + "/" + mode.name;
+    std::string reference = std::string(GOLDEN_DIRECTORY) + "/" + viewpoint.name + ".ppm";
+
+    rg::glState().bindFramebuffer(0);
+    rg::Image image = rg::readFramebuffer(width, height);
+    if (golden.update && golden.mode == 0) {
+        bool written = rg::writePpm(reference, image);
+        golden.failures += !written;
+        std::cout << "[golden] " << name << (written ? ": reference written to " : ": FAILED to write ") << reference << std::endl;
+    } else {
+        rg::Image expected;
+        rg::ImageDifference difference;
+        bool referenced = rg::readPpm(reference, expected);
+        if (referenced)
+            difference = rg::compareImages(expected, image, mode.deltaETolerance);
+        bool passed = difference.comparable && difference.failingShare <= mode.maxFailingShare;
+        if (!referenced) {
+            std::cout << "[golden] " << name << ": SKIPPED, no reference " << reference
+                      << " (recorded with --golden-update, see " << GOLDEN_DIRECTORY << "/README.md)" << std::endl;
+        } else if (!difference.comparable) {
+            std::cout << "[golden] " << name << ": FAILED, the reference " << reference << " is " << expected.width << "x"
+                      << expected.height << ", not " << width << "x" << height << std::endl;
+        } else {
+            std::cout << "[golden] " << name << ": " << (passed ? "ok" : "FAILED") << ", mean delta E " << difference.meanDeltaE
+                      << ", max " << difference.maxDeltaE << ", " << difference.failingShare * 100.0f << "% of pixels over "
+                      << mode.deltaETolerance << " (" << mode.maxFailingShare * 100.0f << "% allowed)" << std::endl;
+        }
+        if (!passed) {
+            if (referenced)
+                golden.failures++;
+            else
+                golden.missing++;
+            rg::writePpm(std::string(GOLDEN_DIRECTORY) + "/" + viewpoint.name + "_" + mode.name + "_actual.ppm", image);
+        }
     }
+
+    if (++golden.mode < GOLDEN_MODE_COUNT)
+        return false;
+    golden.mode = 0;
+    return ++golden.viewpoint == viewpoints.size();
 }
 
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
+    redrawRequested = true;
+    framePacer.inputArrived();
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -596,17 +1575,19 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
+    redrawRequested = true;
+    framePacer.inputArrived();
     programState->camera.ProcessMouseScroll(yoffset);
 }
 
 int clicked = 0;
-void DrawImGui(ProgramState *programState) {
+void DrawImGui(ProgramState *programState, const RenderStats& stats) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
 
-    {
+    if (programState->ImGuiEnabled) {
         static float f = 0.0f;
         ImGui::Begin("Parameters");
         ImGui::DragFloat("pointLight.constant", &programState->pointLight.constant, 0.01, 0.0, 1.0);
@@ -614,10 +1595,14 @@ void DrawImGui(ProgramState *programState) {
         ImGui::DragFloat("pointLight.quadratic", &programState->pointLight.quadratic, 0.00001, 0.0, 1.0);//Has little purpose since the constants are too low
         ImGui::DragFloat("Movement speed", &programState->camera.MovementSpeed, 0.05, 0.0, 50.0);
         ImGui::DragFloat("Exposure", &programState->exposure, 0.05, 0.0, 10.0);
+        if (rg::glExtensions().computeShader) {
+            ImGui::Checkbox("Auto exposure", &programState->autoExposure);
+            ImGui::DragFloat("Adaptation speed", &programState->adaptationSpeed, 0.05, 0.05, 10.0);
+        }
         ImGui::End();
     }
 
-    {
+    if (programState->ImGuiEnabled) {
         ImGui::Begin("Camera info and settings");
         const Camera& c = programState->camera;
         ImGui::Text("Camera position: (%f, %f, %f)", c.Position.x, c.Position.y, c.Position.z);
@@ -646,15 +1631,100 @@ void DrawImGui(ProgramState *programState) {
             programState->camera.Position = glm::vec3(0.0f, 0.0f, 3.0f);
         ImGui::Checkbox("Enable fong", &programState->enable_fong);
         ImGui::Checkbox("Enable bloom", &programState->enable_bloom);
+        ImGui::DragFloat("Bloom threshold", &programState->bloomThreshold, 0.05, 0.0, 50.0);
+        ImGui::DragFloat("Bloom knee", &programState->bloomKnee, 0.05, 0.0, 5.0);
         ImGui::Checkbox("Enable HDR", &programState->enable_HDR);
+        ImGui::Checkbox("Depth pre-pass", &programState->depthPrepass);
+        ImGui::Checkbox("Low latency", &programState->lowLatency);
+        if (programState->lowLatency)
+            ImGui::SliderInt("Frames in flight", &programState->maxFramesInFlight, 1, 3);
+        ImGui::DragFloat("Frame limit (fps, 0 off)", &programState->frameLimit, 1.0, 0.0, 500.0);
+        if (stats.inputLatencyMs > 0.0f)
+            ImGui::Text("Input to present: %.1f ms, %u frames in flight", stats.inputLatencyMs, stats.framesInFlight);
+        ImGui::Checkbox("On-demand rendering", &programState->onDemand);
+        if (programState->onDemand)
+            ImGui::DragFloat("Redraw threshold (px)", &programState->redrawThreshold, 0.05, 0.05, 20.0);
+        ImGui::Checkbox("Temporal upscaling", &programState->temporalUpscaling);
+        ImGui::SliderFloat("Render scale", &programState->renderScale, 0.5, 1.0);
+        ImGui::Checkbox("FXAA", &programState->fxaa);
+        const char* presetNames[FXAA_PRESET_COUNT];
+        for (int i = 0; i < FXAA_PRESET_COUNT; i++)
+            presetNames[i] = FXAA_PRESETS[i].name;
+        ImGui::Combo("FXAA quality", &programState->fxaaQuality, presetNames, FXAA_PRESET_COUNT);
+        const char* formatNames[rg::HDR_FORMAT_COUNT];
+        for (int i = 0; i < rg::HDR_FORMAT_COUNT; i++)
+            formatNames[i] = rg::HDR_FORMATS[i].name;
+        ImGui::Combo("HDR target format", &programState->hdrFormat, formatNames, rg::HDR_FORMAT_COUNT);
+        ImGui::SliderInt("Bloom passes", &programState->bloomPasses, 0, 12);
+        ImGui::SliderFloat("Texture LOD bias", &programState->lodBias, -1.0, 2.0);
+        if (ImGui::CollapsingHeader("Quality presets")) {
+            const char* qualityNames[QUALITY_PRESET_COUNT];
+            for (int i = 0; i < QUALITY_PRESET_COUNT; i++)
+                qualityNames[i] = QUALITY_PRESETS[i].name;
+            int preset = std::max(programState->qualityPreset, 0);
+            if (ImGui::Combo("Preset", &preset, qualityNames, QUALITY_PRESET_COUNT))
+                applyQualityPreset(preset);
+            ImGui::DragFloat("Target frame time (ms)", &programState->targetFrameMs, 0.1, 2.0, 100.0);
+            if (autoTuner.running())
+                ImGui::Text("Tuning %s...", QUALITY_PRESETS[autoTuner.preset()].name);
+            else if (ImGui::Button("Tune again"))
+                startAutoTuning();
+            ImGui::TextWrapped("Tuned for %s", programState->tunedFor.c_str());
+        }
+        ImGui::Combo("Debug view", &programState->heatmap, HEATMAP_NAMES, sizeof(HEATMAP_NAMES) / sizeof(HEATMAP_NAMES[0]));
+        if (programState->heatmap != rg::HEATMAP_OFF) {
+            ImGui::DragFloat(programState->heatmap == rg::HEATMAP_OVERDRAW ? "Layers shown white" : "Cost shown white",
+                             &programState->heatmapScale, 0.1, 1.0, 200.0);
+            ImGui::Text("blue - green - yellow - red - white");
+        }
+        if (ImGui::CollapsingHeader("GPU pass timings")) {
+            if (rg::glExtensions().pipelineStatistics)
+                ImGui::Checkbox("Shader invocations", &programState->pipelineStatistics);
+            for (const rg::PassTiming& timing : stats.passTimings) {
+                if (stats.pipelineStatistics)
+                    ImGui::Text("%-9s %6.3f ms  %9llu VS  %10llu FS", timing.pass, timing.milliseconds,
+                                (unsigned long long)timing.vertexInvocations, (unsigned long long)timing.fragmentInvocations);
+                else
+                    ImGui::Text("%-9s %6.3f ms", timing.pass, timing.milliseconds);
+            }
+            ImGui::Text("Total     %6.3f ms", stats.gpuMs);
+        }
+        if (ImGui::CollapsingHeader("Render target traffic (estimate)")) {
+            for (const rg::PassTraffic& traffic : stats.bandwidth.passes)
+                ImGui::Text("%-8s read %7.2f MB, written %7.2f MB", traffic.pass, traffic.bytesRead / 1e6, traffic.bytesWritten / 1e6);
+            ImGui::Text("Total    read %7.2f MB, written %7.2f MB", stats.bandwidth.totalRead() / 1e6, stats.bandwidth.totalWritten() / 1e6);
+        }
+        const rg::GLStateCounters& glStateCalls = stats.glStateCalls;
+        ImGui::Text("GL state calls: %u issued, %u skipped", glStateCalls.issued, glStateCalls.skipped);
+        const rg::GLCallCounters& glCalls = stats.glCalls;
+        ImGui::Text("GL calls: %u (state %u, uniform %u, draw %u, query %u)", glCalls.total(),
+                    glCalls.calls[rg::GL_CALL_STATE], glCalls.calls[rg::GL_CALL_UNIFORM],
+                    glCalls.calls[rg::GL_CALL_DRAW], glCalls.calls[rg::GL_CALL_QUERY]);
+        rg::JobSystemStats jobStats = rg::jobs().stats();
+        ImGui::Text("Jobs: %u run, %u stolen, %u workers", jobStats.executed, jobStats.stolen, jobStats.workers);
+        if (rg::glDebugOutputEnabled())
+            ImGui::Text("GL errors reported: %u", rg::glDebugErrors().load());
+        const rg::RenderTargetPoolStats& targetStats = stats.renderTargets;
+        ImGui::Text("Render targets: %u (%u in use), %.1f MB, %u allocations, %ux%u",
+                    targetStats.targets, targetStats.inUse, targetStats.allocatedBytes / 1e6, targetStats.allocations, stats.renderWidth, stats.renderHeight);
         ImGui::End();
     }
 
+    if (performanceHud.visible)
+        performanceHud.draw(stats.glCalls, stats.glStateCalls, stats.renderTargets, stats.inputLatencyMs);
+
+    //drawn by the render side
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    redrawRequested = true;
+    framePacer.inputArrived();
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    redrawRequested = true;
+    framePacer.inputArrived();
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
         if (programState->ImGuiEnabled) {
@@ -663,6 +1733,8 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
         }
     }
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+        performanceHud.visible = !performanceHud.visible;
 }
 
 unsigned int loadCubemap(vector<std::string> faces)
@@ -671,15 +1743,21 @@ unsigned int loadCubemap(vector<std::string> faces)
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
+    //The faces decode in parallel, the upload stays on this thread
+    vector<DecodedTexture> images(faces.size());
+    rg::jobs().parallelFor(0, faces.size(), 1, [&](size_t i) {
+        images[i].data = stbi_load(faces[i].c_str(), &images[i].width, &images[i].height, &images[i].components, 0);
+    });
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        int width = images[i].width, height = images[i].height;
+        unsigned char *data = images[i].data;
         if (data)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
                          0, GL_SRGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
             );
+            rg::gpuMemory().textureBytes += (uint64_t)width * height * 4;//no mipmaps
             stbi_image_free(data);
         }
         else
@@ -723,8 +1801,8 @@ void renderQuad()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    rg::glState().bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    rg::glCalls().countDraw(2);
 }
 